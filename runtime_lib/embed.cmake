@@ -0,0 +1,6 @@
+# 将二进制文件转换为C数组的初始化列表，供编译器嵌入运行时库的bitcode
+# cmake -DINPUT=sylib.bc -DOUTPUT=sylib_bitcode.inc -P embed.cmake
+
+file(READ ${INPUT} content HEX)
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," content "${content}")
+file(WRITE ${OUTPUT} "${content}\n")
@@ -66,12 +66,13 @@ void putf(char a[], ...) {
 }
 
 /* Timing function implementation */
-__attribute((constructor)) void before_main() {
+struct timeval _sysy_start, _sysy_end;
+_SYSY_CONSTRUCTOR void before_main() {
     for (int i = 0; i < _SYSY_N; i++)
         _sysy_h[i] = _sysy_m[i] = _sysy_s[i] = _sysy_us[i] = 0;
     _sysy_idx = 1;
 }
-__attribute((destructor)) void after_main() {
+_SYSY_DESTRUCTOR void after_main() {
     for (int i = 1; i < _sysy_idx; i++) {
         fprintf(stderr, "Timer@%04d-%04d: %dH-%dM-%dS-%dus\n", _sysy_l1[i],
                 _sysy_l2[i], _sysy_h[i], _sysy_m[i], _sysy_s[i], _sysy_us[i]);
@@ -103,3 +104,197 @@ void _sysy_stoptime(int lineno) {
     _sysy_m[_sysy_idx] %= 60;
     _sysy_idx++;
 }
+
+/* Parallel loop runtime implementation */
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+/* Number of threads including the calling thread, 0 before the pool is
+   created; SYSY_NUM_THREADS overrides the number of online processors */
+static int _sysy_threads;
+static pthread_mutex_t _sysy_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _sysy_pool_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _sysy_pool_done = PTHREAD_COND_INITIALIZER;
+/* Incremented for each parallel loop, workers wait for it to change */
+static unsigned _sysy_generation;
+static int _sysy_pending;
+static struct {
+    int begin, end;
+    void (*body)(int, int, int, void *);
+    void *ctx;
+} _sysy_task;
+
+/* Static scheduling: thread t runs the t-th of _sysy_threads contiguous
+   chunks of nearly equal size */
+static void _sysy_run_chunk(int thread) {
+    long long count = (long long)_sysy_task.end - _sysy_task.begin;
+    int lo = (int)(_sysy_task.begin + count * thread / _sysy_threads);
+    int hi = (int)(_sysy_task.begin + count * (thread + 1) / _sysy_threads);
+    if (lo < hi)
+        _sysy_task.body(lo, hi, thread, _sysy_task.ctx);
+}
+static void *_sysy_worker(void *arg) {
+    int thread = (int)(long)arg;
+    unsigned seen = 0;
+    pthread_mutex_lock(&_sysy_pool_lock);
+    for (;;) {
+        while (_sysy_generation == seen)
+            pthread_cond_wait(&_sysy_pool_start, &_sysy_pool_lock);
+        seen = _sysy_generation;
+        pthread_mutex_unlock(&_sysy_pool_lock);
+        _sysy_run_chunk(thread);
+        pthread_mutex_lock(&_sysy_pool_lock);
+        if (--_sysy_pending == 0)
+            pthread_cond_signal(&_sysy_pool_done);
+    }
+    return NULL;
+}
+static void _sysy_create_pool() {
+    const char *env = getenv("SYSY_NUM_THREADS");
+    long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        n = 1;
+    if (n > _SYSY_MAX_THREADS)
+        n = _SYSY_MAX_THREADS;
+    _sysy_threads = 1;
+    for (long i = 1; i < n; i++) {
+        pthread_t worker;
+        if (pthread_create(&worker, NULL, _sysy_worker, (void *)i) != 0)
+            break;
+        pthread_detach(worker);
+        _sysy_threads++;
+    }
+}
+/* Fork/join: the calling thread runs chunk 0 and waits for the workers.
+   Parallel loops are never nested, so only the main thread calls this */
+void _sysy_parallel_for(int begin, int end,
+                        void (*body)(int, int, int, void *), void *ctx) {
+    if (!_sysy_threads)
+        _sysy_create_pool();
+    if (_sysy_threads == 1) {
+        if (begin < end)
+            body(begin, end, 0, ctx);
+        return;
+    }
+    pthread_mutex_lock(&_sysy_pool_lock);
+    _sysy_task.begin = begin;
+    _sysy_task.end = end;
+    _sysy_task.body = body;
+    _sysy_task.ctx = ctx;
+    _sysy_pending = _sysy_threads - 1;
+    _sysy_generation++;
+    pthread_cond_broadcast(&_sysy_pool_start);
+    pthread_mutex_unlock(&_sysy_pool_lock);
+    _sysy_run_chunk(0);
+    pthread_mutex_lock(&_sysy_pool_lock);
+    while (_sysy_pending)
+        pthread_cond_wait(&_sysy_pool_done, &_sysy_pool_lock);
+    pthread_mutex_unlock(&_sysy_pool_lock);
+}
+
+/* Kernel implementation: the innermost loop runs along j and is contiguous
+   for row-major arrays, so it vectorizes (NEON on arm); j and k are blocked
+   so that a block of b stays in cache while all rows of c are updated.
+   Every element still accumulates its products in the original order (k, or
+   p then q, ascending), so float results are identical to the loop nest as
+   long as multiply and add are not contracted (build with -ffp-contract=off);
+   int arithmetic is done in unsigned to wrap like the compiled code */
+#define _SYSY_BLOCK_J 128
+#define _SYSY_BLOCK_K 64
+#define _SYSY_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define _SYSY_ZERO(c, m, n, ci, cj)                                           \
+    for (int i = 0; i < m; i++)                                               \
+        for (int j = 0; j < n; j++)                                           \
+            c[(long)i * ci + (long)j * cj] = 0;
+/* Rows of a and columns of b contiguous along k (e.g. c[i][j] += a[i][k] *
+   b[j][k]): four dot products at a time, each summed in k order, for the
+   rows of b in a block */
+#define _SYSY_MATMUL_DOT(U)                                                   \
+    for (int jb = 0; jb < n; jb += _SYSY_BLOCK_K) {                           \
+        int je = _SYSY_MIN(n, jb + _SYSY_BLOCK_K);                            \
+        for (int i = 0; i < m; i++) {                                         \
+            const U *ar = (const U *)a + (long)i * ai;                        \
+            U *cr = (U *)c + (long)i * ci;                                    \
+            int j = jb;                                                       \
+            for (; j + 4 <= je; j += 4) {                                     \
+                const U *b0 = (const U *)b + (long)j * bj, *b1 = b0 + bj,     \
+                        *b2 = b1 + bj, *b3 = b2 + bj;                         \
+                U s0 = cr[(long)j * cj], s1 = cr[(long)(j + 1) * cj],         \
+                  s2 = cr[(long)(j + 2) * cj], s3 = cr[(long)(j + 3) * cj];   \
+                for (int p = 0; p < k; p++) {                                 \
+                    U x = ar[p];                                              \
+                    s0 += x * b0[p];                                          \
+                    s1 += x * b1[p];                                          \
+                    s2 += x * b2[p];                                          \
+                    s3 += x * b3[p];                                          \
+                }                                                             \
+                cr[(long)j * cj] = s0;                                        \
+                cr[(long)(j + 1) * cj] = s1;                                  \
+                cr[(long)(j + 2) * cj] = s2;                                  \
+                cr[(long)(j + 3) * cj] = s3;                                  \
+            }                                                                 \
+            for (; j < je; j++) {                                             \
+                const U *b0 = (const U *)b + (long)j * bj;                    \
+                U s0 = cr[(long)j * cj];                                      \
+                for (int p = 0; p < k; p++)                                   \
+                    s0 += ar[p] * b0[p];                                      \
+                cr[(long)j * cj] = s0;                                        \
+            }                                                                 \
+        }                                                                     \
+    }
+#define _SYSY_DEFINE_KERNELS(SUFFIX, T, U)                                    \
+void _sysy_matmul_##SUFFIX(int m, int n, int k, T *c, int ci, int cj,         \
+                           const T *a, int ai, int ak, const T *b, int bk,    \
+                           int bj, int accumulate) {                          \
+    if (!accumulate)                                                          \
+        _SYSY_ZERO(c, m, n, ci, cj)                                           \
+    if (ak == 1 && bk == 1 && !(cj == 1 && bj == 1)) {                        \
+        _SYSY_MATMUL_DOT(U)                                                   \
+        return;                                                               \
+    }                                                                         \
+    for (int jb = 0; jb < n; jb += _SYSY_BLOCK_J) {                           \
+        int je = _SYSY_MIN(n, jb + _SYSY_BLOCK_J);                            \
+        for (int kb = 0; kb < k; kb += _SYSY_BLOCK_K) {                       \
+            int ke = _SYSY_MIN(k, kb + _SYSY_BLOCK_K);                        \
+            for (int i = 0; i < m; i++) {                                     \
+                U *restrict cr = (U *)c + (long)i * ci;                       \
+                for (int p = kb; p < ke; p++) {                               \
+                    U x = ((const U *)a)[(long)i * ai + (long)p * ak];        \
+                    const U *restrict br = (const U *)b + (long)p * bk;       \
+                    if (cj == 1 && bj == 1)                                   \
+                        for (int j = jb; j < je; j++)                         \
+                            cr[j] += x * br[j];                               \
+                    else                                                      \
+                        for (int j = jb; j < je; j++)                         \
+                            cr[(long)j * cj] += x * br[(long)j * bj];         \
+                }                                                             \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+}                                                                             \
+void _sysy_conv2d_##SUFFIX(int m, int n, int p, int q, T *o, int oi, int oj,  \
+                           const T *x, int xi, int xj, int xp, int xq,        \
+                           const T *w, int wp, int wq, int accumulate) {      \
+    if (!accumulate)                                                          \
+        _SYSY_ZERO(o, m, n, oi, oj)                                           \
+    for (int jb = 0; jb < n; jb += _SYSY_BLOCK_J) {                           \
+        int je = _SYSY_MIN(n, jb + _SYSY_BLOCK_J);                            \
+        for (int i = 0; i < m; i++) {                                         \
+            U *restrict or_ = (U *)o + (long)i * oi;                          \
+            for (int s = 0; s < p; s++)                                       \
+                for (int t = 0; t < q; t++) {                                 \
+                    U v = ((const U *)w)[(long)s * wp + (long)t * wq];        \
+                    const U *restrict xr = (const U *)x + (long)i * xi +      \
+                                           (long)s * xp + (long)t * xq;       \
+                    if (oj == 1 && xj == 1)                                   \
+                        for (int j = jb; j < je; j++)                         \
+                            or_[j] += v * xr[j];                              \
+                    else                                                      \
+                        for (int j = jb; j < je; j++)                         \
+                            or_[(long)j * oj] += v * xr[(long)j * xj];        \
+                }                                                             \
+        }                                                                     \
+    }                                                                         \
+}
+_SYSY_DEFINE_KERNELS(i32, int, unsigned)
+_SYSY_DEFINE_KERNELS(f32, float, float)
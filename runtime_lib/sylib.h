@@ -23,9 +23,42 @@ extern struct timeval _sysy_start, _sysy_end;
 int _sysy_l1[_SYSY_N], _sysy_l2[_SYSY_N];
 int _sysy_h[_SYSY_N], _sysy_m[_SYSY_N], _sysy_s[_SYSY_N], _sysy_us[_SYSY_N];
 int _sysy_idx;
-__attribute((constructor)) void before_main();
-__attribute((destructor)) void after_main();
+/* When the compiler runs a program in-process (--run), the timer setup and
+   report are invoked explicitly around main instead of by the loader */
+#ifdef SYSY_RUNTIME_MANUAL_INIT
+#define _SYSY_CONSTRUCTOR
+#define _SYSY_DESTRUCTOR
+#else
+#define _SYSY_CONSTRUCTOR __attribute((constructor))
+#define _SYSY_DESTRUCTOR __attribute((destructor))
+#endif
+_SYSY_CONSTRUCTOR void before_main();
+_SYSY_DESTRUCTOR void after_main();
 void _sysy_starttime(int lineno);
 void _sysy_stoptime(int lineno);
 
+/* Parallel loop runtime: loops parallelized by the compiler (--parallel) are
+   outlined into body(begin, end, thread, ctx) and the iteration range is split
+   among a pool of worker threads; thread is in [0, _SYSY_MAX_THREADS) */
+#define _SYSY_MAX_THREADS 16
+void _sysy_parallel_for(int begin, int end,
+                        void (*body)(int, int, int, void *), void *ctx);
+
+/* Kernels for loop nests recognized by the compiler (--kernels), strides are
+   in elements and may be zero or negative; accumulate = 0 starts from zero
+   matmul: c[i*ci + j*cj] (+)= sum_k a[i*ai + k*ak] * b[k*bk + j*bj]
+   conv2d: o[i*oi + j*oj] (+)= sum_p sum_q x[i*xi + j*xj + p*xp + q*xq] * w[p*wp + q*wq] */
+void _sysy_matmul_i32(int m, int n, int k, int *c, int ci, int cj,
+                      const int *a, int ai, int ak, const int *b, int bk, int bj,
+                      int accumulate);
+void _sysy_matmul_f32(int m, int n, int k, float *c, int ci, int cj,
+                      const float *a, int ai, int ak, const float *b, int bk, int bj,
+                      int accumulate);
+void _sysy_conv2d_i32(int m, int n, int p, int q, int *o, int oi, int oj,
+                      const int *x, int xi, int xj, int xp, int xq,
+                      const int *w, int wp, int wq, int accumulate);
+void _sysy_conv2d_f32(int m, int n, int p, int q, float *o, int oi, int oj,
+                      const float *x, int xi, int xj, int xp, int xq,
+                      const float *w, int wp, int wq, int accumulate);
+
 #endif
@@ -0,0 +1,171 @@
+; SysY运行时库（sylib.c）中输入输出函数的LLVM IR版本
+; 构建时由llvm-as编译为bitcode并嵌入编译器，优化前链接进模块，使库函数可以被内联、特化
+; 不含triple与data layout，链接时使用目标平台的设置，因此只能使用与平台无关的类型：
+; 计时函数依赖struct timeval的布局（各平台long的宽度不同），仍由sylib.c提供
+; 修改时需要与sylib.c保持一致
+; 对printf/scanf的调用标注了与src/frontend/lib.cpp中原型相同的内存属性，内联后仍然有效：
+; 除了参数指向的内存，只访问程序不可见的stdin/stdout
+
+source_filename = "sylib.c"
+
+@.fmt.int = private unnamed_addr constant [3 x i8] c"%d\00"
+@.fmt.char = private unnamed_addr constant [3 x i8] c"%c\00"
+@.fmt.float = private unnamed_addr constant [3 x i8] c"%a\00"
+@.fmt.length = private unnamed_addr constant [4 x i8] c"%d:\00"
+@.fmt.int.item = private unnamed_addr constant [4 x i8] c" %d\00"
+@.fmt.float.item = private unnamed_addr constant [4 x i8] c" %a\00"
+
+declare i32 @scanf(i8*, ...)
+declare i32 @printf(i8*, ...)
+declare i32 @putchar(i32)
+
+; int getint()
+define i32 @getint() {
+entry:
+  %t = alloca i32
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.int, i32 0, i32 0
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt, i32* nocapture writeonly %t) #0
+  %value = load i32, i32* %t
+  ret i32 %value
+}
+
+; int getch()
+define i32 @getch() {
+entry:
+  %c = alloca i8
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.char, i32 0, i32 0
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt, i8* nocapture writeonly %c) #0
+  %char = load i8, i8* %c
+  ; 与sylib.c中(int)c一致，char为无符号的平台上链接时改为zext（见src/frontend/lib.cpp的linkLibraryBitcode）
+  %value = sext i8 %char to i32
+  ret i32 %value
+}
+
+; float getfloat()
+define float @getfloat() {
+entry:
+  %n = alloca float
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.float, i32 0, i32 0
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt, float* nocapture writeonly %n) #0
+  %value = load float, float* %n
+  ret float %value
+}
+
+; int getarray(int a[])
+define i32 @getarray(i32* %a) {
+entry:
+  %n.addr = alloca i32
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.int, i32 0, i32 0
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt, i32* nocapture writeonly %n.addr) #0
+  %n = load i32, i32* %n.addr
+  %empty = icmp sle i32 %n, 0
+  br i1 %empty, label %exit, label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %element = getelementptr i32, i32* %a, i32 %i
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt, i32* nocapture writeonly %element) #0
+  %i.next = add nsw i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %n
+}
+
+; int getfarray(float a[])
+define i32 @getfarray(float* %a) {
+entry:
+  %n.addr = alloca i32
+  %fmt.length = getelementptr [3 x i8], [3 x i8]* @.fmt.int, i32 0, i32 0
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt.length, i32* nocapture writeonly %n.addr) #0
+  %n = load i32, i32* %n.addr
+  %empty = icmp sle i32 %n, 0
+  br i1 %empty, label %exit, label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %element = getelementptr float, float* %a, i32 %i
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.float, i32 0, i32 0
+  call i32 (i8*, ...) @scanf(i8* nocapture readonly %fmt, float* nocapture writeonly %element) #0
+  %i.next = add nsw i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %n
+}
+
+; void putint(int a)
+define void @putint(i32 %a) {
+entry:
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.int, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* nocapture readonly %fmt, i32 %a) #0
+  ret void
+}
+
+; void putch(int a)，即printf("%c", a)
+define void @putch(i32 %a) {
+entry:
+  call i32 @putchar(i32 %a) #1
+  ret void
+}
+
+; void putarray(int n, int a[])
+define void @putarray(i32 %n, i32* %a) {
+entry:
+  %fmt.length = getelementptr [4 x i8], [4 x i8]* @.fmt.length, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* nocapture readonly %fmt.length, i32 %n) #0
+  %empty = icmp sle i32 %n, 0
+  br i1 %empty, label %exit, label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %element = getelementptr i32, i32* %a, i32 %i
+  %value = load i32, i32* %element
+  %fmt = getelementptr [4 x i8], [4 x i8]* @.fmt.int.item, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* nocapture readonly %fmt, i32 %value) #0
+  %i.next = add nsw i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  call i32 @putchar(i32 10) #1
+  ret void
+}
+
+; void putfloat(float a)
+define void @putfloat(float %a) {
+entry:
+  %fmt = getelementptr [3 x i8], [3 x i8]* @.fmt.float, i32 0, i32 0
+  %value = fpext float %a to double
+  call i32 (i8*, ...) @printf(i8* nocapture readonly %fmt, double %value) #0
+  ret void
+}
+
+; void putfarray(int n, float a[])
+define void @putfarray(i32 %n, float* %a) {
+entry:
+  %fmt.length = getelementptr [4 x i8], [4 x i8]* @.fmt.length, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* nocapture readonly %fmt.length, i32 %n) #0
+  %empty = icmp sle i32 %n, 0
+  br i1 %empty, label %exit, label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %element = getelementptr float, float* %a, i32 %i
+  %value = load float, float* %element
+  %value.ext = fpext float %value to double
+  %fmt = getelementptr [4 x i8], [4 x i8]* @.fmt.float.item, i32 0, i32 0
+  call i32 (i8*, ...) @printf(i8* nocapture readonly %fmt, double %value.ext) #0
+  %i.next = add nsw i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  call i32 @putchar(i32 10) #1
+  ret void
+}
+
+attributes #0 = { nounwind willreturn inaccessiblemem_or_argmemonly }
+attributes #1 = { nounwind willreturn inaccessiblememonly }
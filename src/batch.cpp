@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include "log.h"
+#include "target.h"
+#include "cache.h"
+#include "batch.h"
+
+// 未指定输出文件时，按输出类型替换输入文件的扩展名
+static std::string outputFilename(const Options &options, const std::string &inputFilename) {
+    llvm::SmallString<128> path(inputFilename);
+    switch (options.outputType) {
+        case OutputType::ASSEMBLY:
+            llvm::sys::path::replace_extension(path, "s");
+            break;
+        case OutputType::OBJECT:
+            llvm::sys::path::replace_extension(path, "o");
+            break;
+        case OutputType::EXECUTABLE:
+            llvm::sys::path::replace_extension(path, "");
+            break;
+        case OutputType::LLVM_ASSEMBLY:
+            llvm::sys::path::replace_extension(path, "ll");
+            break;
+        case OutputType::LLVM_BITCODE:
+            llvm::sys::path::replace_extension(path, "bc");
+            break;
+    }
+    if (path == inputFilename) {
+        throw std::runtime_error("cannot derive output filename for " + inputFilename);
+    }
+    return path.str().str();
+}
+
+// 读取列表文件，每行为“输入文件 [输出文件]”，忽略空行与#开头的注释
+static std::vector<Options> readList(const Options &options) {
+    std::ifstream listFile(options.batchFilename);
+    if (!listFile) {
+        throw std::runtime_error("failed to open file: " + options.batchFilename);
+    }
+
+    std::vector<Options> jobs;
+    std::string line;
+    while (std::getline(listFile, line)) {
+        std::istringstream fields(line);
+        std::string input, output, extra;
+        if (!(fields >> input) || input[0] == '#') {
+            continue;
+        }
+        fields >> output;
+        if (fields >> extra) {
+            throw std::runtime_error("invalid line in " + options.batchFilename + ": " + line);
+        }
+
+        Options job = options;
+        job.batchFilename.clear();
+        job.inputFilename = input;
+        job.irInput = Options::isIRFilename(input);
+        job.outputFilename = output.empty() ? outputFilename(options, input) : output;
+        // 并行度用在文件之间，单个文件内不再划分
+        job.jobs = 1;
+        // 缓存统计在所有文件编译完成后统一输出
+        job.cacheStats = false;
+        jobs.emplace_back(std::move(job));
+    }
+    return jobs;
+}
+
+int Batch::run(const Options &options, const CompileFunction &compile) {
+    std::vector<Options> jobs = readList(options);
+
+    // 所有工作线程共享目标平台的初始化
+    Target::initialize();
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<int> status(jobs.size(), 0);
+    std::mutex outputMutex;
+    {
+        llvm::ThreadPool pool(llvm::hardware_concurrency(options.jobs));
+        for (size_t i = 0; i < jobs.size(); i++) {
+            pool.async([&, i] {
+                const Options &job = jobs[i];
+                std::string message;
+                try {
+                    status[i] = compile(job);
+                } catch (std::runtime_error &e) {
+                    status[i] = 1;
+                    message = "invalid source file: " + std::string(e.what());
+                } catch (std::exception &e) {
+                    status[i] = 2;
+                    message = "internal error: " + std::string(e.what());
+                }
+                if (!message.empty()) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    err("batch") << job.inputFilename << ": " << message << std::endl;
+                }
+            });
+        }
+        pool.wait();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    size_t failed = std::count_if(status.begin(), status.end(), [](int s) { return s != 0; });
+    std::cerr << "batch: " << jobs.size() << " files, " << failed << " failed, "
+              << elapsed.count() << "s, " << jobs.size() / elapsed.count() << " files/s, "
+              << llvm::hardware_concurrency(options.jobs).compute_thread_count() << " threads" << std::endl;
+
+    if (options.cacheStats) {
+        CompileCache::printStats(options);
+    }
+
+    return status.empty() ? 0 : *std::max_element(status.begin(), status.end());
+}
@@ -0,0 +1,18 @@
+#ifndef SYSY_COMPILER_BATCH_H
+#define SYSY_COMPILER_BATCH_H
+
+#include <functional>
+#include "options.h"
+
+// 批量编译（--batch）：在一个进程内用线程池编译列表中的所有源文件，共享目标平台的初始化
+// 每个源文件在一个工作线程中使用独立的IR上下文、词法分析器与AST内存完成编译，-j N为工作线程数
+namespace Batch {
+    // 编译一个源文件，出错时抛出异常
+    using CompileFunction = std::function<int(const Options &options)>;
+
+    // 编译列表中的所有文件，输出每个失败的文件以及吞吐量（文件/秒）
+    // 全部成功时返回0，否则返回各文件退出码中的最大值
+    int run(const Options &options, const CompileFunction &compile);
+}
+
+#endif //SYSY_COMPILER_BATCH_H
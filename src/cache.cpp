@@ -0,0 +1,240 @@
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <iostream>
+#include <string>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+#include "magic_enum.h"
+#include "log.h"
+#include "cache.h"
+
+// 缓存条目的文件名前缀，llvm::pruneCache只会淘汰带有此前缀的文件
+static constexpr const char *entryPrefix = "llvmcache-";
+
+// 当前编译器可执行文件的身份（大小、修改时间），重新构建编译器后旧的缓存条目自动失效
+static std::string executableIdentity() {
+    std::string path = llvm::sys::fs::getMainExecutable(
+            nullptr,
+            reinterpret_cast<void *>(&CompileCache::configurationKey)
+    );
+    llvm::sys::fs::file_status status;
+    if (path.empty() || llvm::sys::fs::status(path, status)) {
+        return "unknown";
+    }
+    auto mtime = status.getLastModificationTime().time_since_epoch();
+    return path + ";" + std::to_string(status.getSize()) + ";" +
+           std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime).count());
+}
+
+// 构建时的配置，会影响生成的代码
+static std::string buildConfiguration() {
+    std::string conf;
+#ifdef CONF_HARD_FLOAT
+    conf += "hard-float;";
+#endif
+#ifdef CONF_USE_DEMO_PASS
+    conf += "demo-pass;";
+#endif
+#ifdef CONF_USE_DEMO_REG_ALLOC
+    conf += "demo-reg-alloc;";
+#endif
+    return conf;
+}
+
+static std::string entryPath(const Options &options, const std::string &key) {
+    llvm::SmallString<128> path(options.cacheDir);
+    llvm::sys::path::append(path, entryPrefix + key);
+    return path.str().str();
+}
+
+// 每个字段带上名字和长度，避免不同字段拼接后产生歧义
+static void addField(llvm::SHA1 &hasher, llvm::StringRef name, llvm::StringRef value) {
+    hasher.update(name);
+    hasher.update(":" + std::to_string(value.size()) + ":");
+    hasher.update(value);
+}
+
+bool CompileCache::enabled(const Options &options) {
+    return !options.cacheDir.empty() && !options.run && options.outputType != OutputType::EXECUTABLE;
+}
+
+std::string CompileCache::configurationKey(const Options &options, const llvm::Module &module) {
+    llvm::SHA1 hasher;
+    addField(hasher, "version", CONF_COMPILER_VERSION " LLVM " LLVM_VERSION_STRING);
+    addField(hasher, "executable", executableIdentity());
+    addField(hasher, "build", buildConfiguration());
+    addField(hasher, "target", options.target);
+    addField(hasher, "opt", std::to_string(options.optLevel));
+    addField(hasher, "runtime-bitcode", options.runtimeBitcode ? "on" : "off");
+    addField(hasher, "memoize", options.memoize ? "on" : "off");
+    addField(hasher, "parallel", options.parallel ? "on" : "off");
+    addField(hasher, "tile-size", std::to_string(options.tileSize));
+    addField(hasher, "kernels", options.kernels ? "on" : "off");
+    addField(hasher, "assume-inbounds", options.assumeInbounds ? "on" : "off");
+
+    // 运行时库函数原型（含triple、data layout与属性），原型变化时缓存失效
+    std::string prototypes;
+    llvm::raw_string_ostream os(prototypes);
+    module.print(os, nullptr);
+    addField(hasher, "prototypes", os.str());
+
+    return llvm::toHex(hasher.final(), true);
+}
+
+std::string CompileCache::computeKey(const Options &options, const std::string &configuration, const std::string &source) {
+    llvm::SHA1 hasher;
+    addField(hasher, "configuration", configuration);
+    addField(hasher, "output", magic_enum::enum_name(options.outputType));
+    addField(hasher, "stage", options.emitPreOpt ? "pre-opt" : "post-opt");
+    addField(hasher, "jobs", std::to_string(options.jobs));
+    addField(hasher, "source", source);
+    return llvm::toHex(hasher.final(), true);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> CompileCache::load(const Options &options, const std::string &key) {
+    std::string path = entryPath(options, key);
+
+    int fd;
+    if (llvm::sys::fs::openFileForRead(path, fd)) {
+        return nullptr;
+    }
+    // 更新访问时间，供LRU淘汰使用（文件系统可能以noatime挂载，不能依赖读取自动更新）
+    llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+    auto buffer = llvm::MemoryBuffer::getOpenFile(fd, path, -1);
+    llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    if (!buffer) {
+        return nullptr;
+    }
+    return std::move(*buffer);
+}
+
+void CompileCache::save(const Options &options, const std::string &key, llvm::StringRef data) {
+    if (auto EC = llvm::sys::fs::create_directories(options.cacheDir)) {
+        log("cache") << "failed to create cache directory: " << EC.message() << std::endl;
+        return;
+    }
+
+    // 先写入临时文件再重命名，避免并发的编译进程读到不完整的条目
+    llvm::SmallString<128> model(options.cacheDir), tempPath;
+    llvm::sys::path::append(model, "tmp-%%%%%%%%");
+    int fd;
+    if (llvm::sys::fs::createUniqueFile(model, fd, tempPath)) {
+        log("cache") << "failed to create temporary file" << std::endl;
+        return;
+    }
+
+    bool failed;
+    {
+        llvm::raw_fd_ostream file(fd, true);
+        file << data;
+        file.close();
+        failed = file.has_error();
+        file.clear_error();
+    }
+    if (failed || llvm::sys::fs::rename(tempPath, entryPath(options, key))) {
+        llvm::sys::fs::remove(tempPath);
+        log("cache") << "failed to store: " << key << std::endl;
+        return;
+    }
+    log("cache") << "store: " << key << std::endl;
+}
+
+void CompileCache::prune(const Options &options) {
+    // 只按最近访问时间淘汰，不设过期时间
+    llvm::CachePruningPolicy policy;
+    policy.Interval = std::chrono::seconds(0);
+    policy.Expiration = std::chrono::seconds(0);
+    policy.MaxSizeBytes = options.cacheSize;
+    llvm::pruneCache(options.cacheDir, policy);
+}
+
+bool CompileCache::fetch(const Options &options, const std::string &key) {
+    bool hit = false;
+    if (auto buffer = load(options, key)) {
+        std::error_code EC;
+        llvm::raw_fd_ostream file(options.outputFilename, EC, llvm::sys::fs::OF_None);
+        if (EC) {
+            throw std::runtime_error("Could not open file: " + EC.message());
+        }
+        file << buffer->getBuffer();
+        hit = true;
+    }
+
+    addStats(options, {{hit ? "hits" : "misses", 1}});
+    log("cache") << (hit ? "hit: " : "miss: ") << key << std::endl;
+    return hit;
+}
+
+void CompileCache::store(const Options &options, const std::string &key) {
+    // 缓存写入失败不影响本次编译的结果
+    auto buffer = llvm::MemoryBuffer::getFile(options.outputFilename);
+    if (!buffer) {
+        log("cache") << "failed to read output file" << std::endl;
+        return;
+    }
+    save(options, key, (*buffer)->getBuffer());
+    prune(options);
+}
+
+// 多个编译进程可能同时访问计数文件，使用文件锁保护
+// 文件锁只在进程之间互斥，批量编译时同一进程内的多个线程还需要互斥锁
+std::map<std::string, uint64_t> CompileCache::addStats(
+        const Options &options,
+        const std::map<std::string, uint64_t> &deltas
+) {
+    static std::mutex statsMutex;
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    llvm::SmallString<128> statsPath(options.cacheDir), lockPath(options.cacheDir);
+    llvm::sys::path::append(statsPath, "stats");
+    llvm::sys::path::append(lockPath, "stats.lock");
+
+    int lockFD;
+    if (llvm::sys::fs::create_directories(options.cacheDir) ||
+        llvm::sys::fs::openFileForReadWrite(lockPath, lockFD, llvm::sys::fs::CD_OpenAlways,
+                                            llvm::sys::fs::OF_None)) {
+        return {};
+    }
+    llvm::sys::fs::lockFile(lockFD);
+
+    std::map<std::string, uint64_t> stats;
+    {
+        std::ifstream statsFile(statsPath.c_str());
+        std::string name;
+        uint64_t value;
+        while (statsFile >> name >> value) {
+            stats[name] = value;
+        }
+    }
+
+    if (!deltas.empty()) {
+        for (auto &[name, delta]: deltas) {
+            stats[name] += delta;
+        }
+        std::ofstream statsFile(statsPath.c_str(), std::ios::trunc);
+        for (auto &[name, value]: stats) {
+            statsFile << name << " " << value << "\n";
+        }
+    }
+
+    llvm::sys::fs::unlockFile(lockFD);
+    llvm::sys::Process::SafelyCloseFileDescriptor(lockFD);
+    return stats;
+}
+
+void CompileCache::printStats(const Options &options) {
+    auto stats = addStats(options, {});
+    std::cerr << "cache hits: " << stats["hits"] << ", misses: " << stats["misses"] << std::endl;
+    if (stats.count("function-hits") || stats.count("function-misses")) {
+        std::cerr << "function cache hits: " << stats["function-hits"]
+                  << ", misses: " << stats["function-misses"] << std::endl;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SYSY_COMPILER_CACHE_H
+#define SYSY_COMPILER_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include "options.h"
+
+// 编译缓存：以整个编译单元的内容为键，缓存生成的汇编文件/目标文件
+// 键由源代码、编译器版本、影响输出的编译选项以及运行时库函数原型共同计算（SHA1）
+// 缓存条目以llvmcache-<键>的形式存放在--cache-dir指定的目录中，
+// 超出--cache-size时按最近访问时间（LRU）淘汰
+// 可执行文件依赖外部链接器与运行时库，不做缓存
+namespace CompileCache {
+    // 是否对本次编译启用缓存
+    bool enabled(const Options &options);
+
+    // 计算与源代码无关的部分：编译器版本、影响IR的编译选项、运行时库函数原型
+    // module中此时应只包含运行时库函数原型
+    std::string configurationKey(const Options &options, const llvm::Module &module);
+
+    // 计算整个编译单元的缓存键
+    std::string computeKey(const Options &options, const std::string &configuration, const std::string &source);
+
+    // 查找缓存，命中时将缓存内容写入输出文件并返回true，同时更新命中/未命中计数
+    bool fetch(const Options &options, const std::string &key);
+
+    // 将生成的输出文件存入缓存，并按大小上限淘汰最久未访问的条目
+    void store(const Options &options, const std::string &key);
+
+    // 读取缓存条目并更新其访问时间，不存在时返回空指针
+    std::unique_ptr<llvm::MemoryBuffer> load(const Options &options, const std::string &key);
+
+    // 写入缓存条目，写入失败不影响编译
+    void save(const Options &options, const std::string &key, llvm::StringRef data);
+
+    // 按大小上限淘汰最久未访问的条目
+    void prune(const Options &options);
+
+    // 累加缓存目录中的计数（如hits、misses），返回累加后的所有计数
+    std::map<std::string, uint64_t> addStats(const Options &options, const std::map<std::string, uint64_t> &deltas);
+
+    // 输出缓存目录中累计的命中/未命中次数
+    void printStats(const Options &options);
+}
+
+#endif //SYSY_COMPILER_CACHE_H
@@ -0,0 +1,61 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "server_protocol.h"
+
+// 编译服务器的客户端，命令行参数与sysy_compiler完全相同：
+// sysy_compiler_client -S -o testcase.s testcase.sy -O2
+// 将参数、工作目录与标准输入/输出/错误转发给sysy_compiler --server，以服务器返回的退出码退出
+// 服务器未运行或不属于当前用户时直接执行同一目录下的sysy_compiler，行为与直接调用编译器一致
+
+// 执行与客户端位于同一目录的sysy_compiler，成功时不返回
+static void fallback(char *argv[]) {
+    char path[PATH_MAX];
+    ssize_t size = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (size < 0) {
+        return;
+    }
+    std::string compiler(path, size);
+    compiler = compiler.substr(0, compiler.rfind('/') + 1) + "sysy_compiler";
+    argv[0] = compiler.data();
+    execv(compiler.c_str(), argv);
+}
+
+int main(int argc, char *argv[]) {
+    std::string socketPath = ServerProtocol::defaultSocketPath();
+    int socket = ServerProtocol::connectTo(socketPath);
+    if (socket < 0) {
+        fallback(argv);
+        std::cerr << "sysy_compiler_client: cannot connect to compile server on " << socketPath
+                  << " and failed to run sysy_compiler: " << strerror(errno) << std::endl;
+        return 2;
+    }
+
+    try {
+        ServerProtocol::Request request;
+        char cwd[PATH_MAX];
+        if (!getcwd(cwd, sizeof(cwd))) {
+            throw std::runtime_error("failed to get working directory: " + std::string(strerror(errno)));
+        }
+        request.workingDirectory = cwd;
+        request.arguments.assign(argv + 1, argv + argc);
+        for (int i = 0; i < 3; i++) {
+            request.fds[i] = i;
+        }
+        ServerProtocol::sendRequest(socket, request);
+
+        int status;
+        if (!ServerProtocol::receiveStatus(socket, status)) {
+            throw std::runtime_error("compile job terminated abnormally");
+        }
+        close(socket);
+        return status;
+    } catch (std::exception &e) {
+        std::cerr << "sysy_compiler_client: " << e.what() << std::endl;
+        return 2;
+    }
+}
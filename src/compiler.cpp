@@ -0,0 +1,181 @@
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticPrinter.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include "IR.h"
+#include "log.h"
+#include "lexer.h"
+#include "parser.h"
+#include "target.h"
+#include "pass_manager.h"
+#include "compiler.h"
+
+// 收集LLVM的诊断信息，代替默认的输出到标准错误（遇到错误时默认会直接退出进程）
+struct DiagnosticCollector {
+    std::string &diagnostics;
+    bool hasError = false;
+
+    static void handle(const llvm::DiagnosticInfo &info, void *context) {
+        auto *collector = static_cast<DiagnosticCollector *>(context);
+        llvm::raw_string_ostream os(collector->diagnostics);
+        os << llvm::LLVMContext::getDiagnosticMessagePrefix(info.getSeverity()) << ": ";
+        llvm::DiagnosticPrinterRawOStream printer(os);
+        info.print(printer);
+        os << "\n";
+        if (info.getSeverity() == llvm::DS_Error) {
+            collector->hasError = true;
+        }
+    }
+};
+
+static size_t countInstructions(const llvm::Module &module) {
+    size_t count = 0;
+    for (const llvm::Function &F: module) {
+        count += F.getInstructionCount();
+    }
+    return count;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+AST::Base *Compiler::parse(std::string source) {
+    Lexer lexer(std::move(source));
+    AST::Base *root = nullptr;
+    yyparse(lexer, root);
+
+    log("main") << "AST root at: " << root << std::endl;
+    return root;
+}
+
+void Compiler::generateIR(AST::Base *root) {
+    // 常量求值，包括：常量初值、全局变量初值、数组维度
+    root->constEval(root);
+
+    // IR生成
+    root->codeGen();
+
+    // 在运行Pass前释放AST占用的内存，降低内存占用峰值
+    Memory::freeAll();
+
+    // 展示原始IR
+    IR::show();
+}
+
+void Compiler::loadIR(llvm::MemoryBufferRef buffer) {
+    llvm::Module &module = IR::ctx->module;
+
+    llvm::SMDiagnostic diagnostic;
+    std::unique_ptr<llvm::Module> input = llvm::parseIR(buffer, diagnostic, module.getContext());
+    if (!input) {
+        std::string message;
+        llvm::raw_string_ostream os(message);
+        diagnostic.print(nullptr, os, false);
+        throw std::runtime_error(os.str());
+    }
+
+    std::string message;
+    llvm::raw_string_ostream os(message);
+    if (llvm::verifyModule(*input, &os)) {
+        throw std::runtime_error("invalid LLVM IR: " + os.str());
+    }
+
+    const std::string &triple = input->getTargetTriple();
+    if (!triple.empty() && llvm::Triple::normalize(triple) != module.getTargetTriple()) {
+        throw std::runtime_error("input IR targets " + triple + ", but compiling for " + module.getTargetTriple());
+    }
+    input->setTargetTriple(module.getTargetTriple());
+    input->setDataLayout(module.getDataLayout());
+
+    // 链接器会按引用顺序重排函数，记录原顺序以保证回放的输出与直接编译一致
+    std::vector<std::string> order;
+    for (const llvm::Function &F: *input) {
+        order.push_back(F.getName().str());
+    }
+
+    if (llvm::Linker::linkModules(module, std::move(input))) {
+        throw std::runtime_error("failed to link input IR");
+    }
+
+    for (const std::string &name: order) {
+        if (llvm::Function *F = module.getFunction(name)) {
+            F->removeFromParent();
+            module.getFunctionList().push_back(F);
+        }
+    }
+
+    // 展示读入的IR
+    IR::show();
+}
+
+Compiler::Result Compiler::compile(std::string_view source, const Options &options) {
+    Result result;
+    Stats &stats = result.stats;
+
+    // 本次编译的IR上下文，在所有引用它的对象之后析构
+    Context context;
+    IR::ContextScope contextScope(context);
+
+    DiagnosticCollector collector{result.diagnostics};
+    // 与默认行为一致，按-pass-remarks等选项过滤优化备注
+    context.llvmCtx.setDiagnosticHandlerCallBack(DiagnosticCollector::handle, &collector, true);
+
+    try {
+        if (options.run || options.outputType == OutputType::EXECUTABLE) {
+            throw std::runtime_error("executable output and --run are not supported");
+        }
+
+        auto targetMachine = Target::createTargetMachine(Target::normalize(options.target));
+        Target::configureModule(context.module, *targetMachine);
+
+        auto begin = std::chrono::steady_clock::now();
+        if (options.irInput) {
+            loadIR(llvm::MemoryBufferRef(llvm::StringRef(source.data(), source.size()), "<input>"));
+        } else {
+            generateIR(parse(std::string(source)));
+        }
+        stats.frontendSeconds = secondsSince(begin);
+
+        for (const llvm::Function &F: context.module) {
+            if (!F.isDeclaration()) {
+                stats.functions++;
+            }
+        }
+        stats.instructionsBefore = countInstructions(context.module);
+
+        begin = std::chrono::steady_clock::now();
+        PassManager::optimize(options, targetMachine.get());
+        stats.optimizeSeconds = secondsSince(begin);
+        stats.instructionsAfter = countInstructions(context.module);
+
+        begin = std::chrono::steady_clock::now();
+        llvm::SmallString<0> buffer;
+        {
+            llvm::raw_svector_ostream out(buffer);
+            PassManager::emit(options, targetMachine.get(), out);
+        }
+        stats.codegenSeconds = secondsSince(begin);
+
+        if (collector.hasError) {
+            result.status = 1;
+        } else {
+            result.output.assign(buffer.begin(), buffer.end());
+        }
+    } catch (std::runtime_error &e) {
+        result.status = 1;
+        result.diagnostics += "invalid source file: " + std::string(e.what()) + "\n";
+    } catch (std::exception &e) {
+        result.status = 2;
+        result.diagnostics += "internal error: " + std::string(e.what()) + "\n";
+    }
+    return result;
+}
@@ -0,0 +1,58 @@
+#ifndef SYSY_COMPILER_COMPILER_H
+#define SYSY_COMPILER_COMPILER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <llvm/Support/MemoryBufferRef.h>
+#include "AST.h"
+#include "options.h"
+
+// 编译器库接口（libsysy_compiler）
+// 在内存中完成从源代码到汇编代码/目标文件的整个编译过程，不读写任何文件，不使用全局状态
+// 每次调用使用独立的Context（LLVMContext、模块、符号表、AST内存），可以在多个线程中同时调用
+namespace Compiler {
+    struct Stats {
+        // 各阶段耗时（秒）：词法语法分析、常量求值与IR生成、优化、代码生成
+        double frontendSeconds = 0;
+        double optimizeSeconds = 0;
+        double codegenSeconds = 0;
+
+        // 函数定义数，优化前后的IR指令数
+        size_t functions = 0;
+        size_t instructionsBefore = 0;
+        size_t instructionsAfter = 0;
+    };
+
+    struct Result {
+        // 退出码，与命令行一致：0成功，1源代码错误，2编译器内部错误
+        int status = 0;
+
+        // 汇编代码或目标文件的内容
+        std::string output;
+
+        // 错误信息以及LLVM输出的诊断信息
+        std::string diagnostics;
+
+        Stats stats;
+    };
+
+    // 编译一个源文件，只使用options中的outputType、emitPreOpt、irInput、optLevel、target与jobs
+    // irInput为true时source为LLVM IR文本或bitcode
+    // 输出类型只能为汇编代码或目标文件，不使用编译缓存；出错时不抛出异常，通过status与diagnostics返回
+    Result compile(std::string_view source, const Options &options);
+
+    // 以下函数作用于当前线程的IR::ctx，供命令行驱动程序复用
+
+    // 词法、语法分析，返回AST根节点，AST的内存由IR::ctx的Arena管理
+    AST::Base *parse(std::string source);
+
+    // 常量求值（包括常量初值、全局变量初值、数组维度）并生成IR
+    void generateIR(AST::Base *root);
+
+    // 读取LLVM IR文本或bitcode（按内容自动识别）代替前端的输出，链接到IR::ctx的模块中
+    // 输入的triple必须与目标平台一致（未指定时采用目标平台的triple），data layout以目标平台为准
+    void loadIR(llvm::MemoryBufferRef buffer);
+}
+
+#endif //SYSY_COMPILER_COMPILER_H
@@ -5,9 +5,7 @@
 
 namespace AST {
 
-    Base *root;
-
-    void show() {
+    void show(Base *root) {
         llvm::json::Value json = std::move(root->toJSON());
         log("AST") << "show AST:" << std::endl;
         log_llvm() << json << '\n';
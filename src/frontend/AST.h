@@ -503,11 +503,10 @@ namespace AST {
     };
 }
 
-// 根节点
+// 以JSON形式输出AST
 namespace AST {
-    extern Base *root;
 
-    void show();
+    void show(Base *root);
 }
 
 #endif //SYSY_COMPILER_FRONTEND_AST_H
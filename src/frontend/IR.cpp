@@ -2,10 +2,10 @@
 #include "log.h"
 
 namespace IR {
-    Context ctx;
+    thread_local Context *ctx = nullptr;
 
     void show() {
         log("IR") << "show IR" << std::endl;
-        ctx.module.print(log_llvm(), nullptr);
+        ctx->module.print(log_llvm(), nullptr);
     }
 }
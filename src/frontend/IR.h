@@ -4,9 +4,28 @@
 #include "context.h"
 
 namespace IR {
-    extern Context ctx;
+    // 当前线程正在编译的源文件的上下文，由Context::Scope设置
+    // 每个编译任务使用独立的Context，不同线程可以同时编译不同的源文件
+    extern thread_local Context *ctx;
 
     void show();
+
+    // 在作用域内将当前线程的IR::ctx设置为context，离开作用域时恢复
+    class ContextScope {
+        Context *saved;
+    public:
+        explicit ContextScope(Context &context) : saved(ctx) {
+            ctx = &context;
+        }
+
+        ~ContextScope() {
+            ctx = saved;
+        }
+
+        ContextScope(const ContextScope &) = delete;
+
+        ContextScope &operator=(const ContextScope &) = delete;
+    };
 }
 
 #endif //SYSY_COMPILER_FRONTEND_IR_H
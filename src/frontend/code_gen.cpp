@@ -26,15 +26,15 @@ llvm::Value *AST::ConstVariableDecl::codeGen() {
     for (ConstVariableDef* def: constVariableDefs) {
         // 确定常量名称，若为局部常量，则补充函数前缀
         std::string varName;
-        if (IR::ctx.function) {
-            llvm::Function* func = IR::ctx.builder.GetInsertBlock()->getParent();
+        if (IR::ctx->function) {
+            llvm::Function* func = IR::ctx->builder.GetInsertBlock()->getParent();
             varName = func->getName().str() + "." + def->name;
         } else {
             varName = def->name;
         }
 
         auto var = new llvm::GlobalVariable(
-                IR::ctx.module,
+                IR::ctx->module,
                 TypeSystem::get(type, convertArraySize(def->size)),
                 true,
                 llvm::GlobalValue::LinkageTypes::InternalLinkage,
@@ -43,7 +43,7 @@ llvm::Value *AST::ConstVariableDecl::codeGen() {
         );
 
         // 将常量插入到符号表
-        IR::ctx.symbolTable.insert(def->name, var);
+        IR::ctx->symbolTable.insert(def->name, var);
 
         // 初始化
         llvm::Constant *initVal = constantInitValConvert(
@@ -58,13 +58,13 @@ llvm::Value *AST::ConstVariableDecl::codeGen() {
 
 llvm::Value *AST::VariableDecl::codeGen() {
     // 生成局部变量/全局变量
-    if (IR::ctx.function) {
+    if (IR::ctx->function) {
         // 局部变量
         for (VariableDef *def: variableDefs) {
             // 在函数头部使用alloca分配空间
             llvm::IRBuilder<> entryBuilder(
-                    &IR::ctx.function->getEntryBlock(),
-                    IR::ctx.function->getEntryBlock().begin()
+                    &IR::ctx->function->getEntryBlock(),
+                    IR::ctx->function->getEntryBlock().begin()
             );
 
             // 生成局部变量
@@ -75,7 +75,7 @@ llvm::Value *AST::VariableDecl::codeGen() {
             );
 
             // 将局部变量插入符号表
-            IR::ctx.symbolTable.insert(def->name, alloca);
+            IR::ctx->symbolTable.insert(def->name, alloca);
 
             // 初始化
             if (def->initVal) {
@@ -87,7 +87,7 @@ llvm::Value *AST::VariableDecl::codeGen() {
         for (VariableDef *def: variableDefs) {
             // 生成全局变量
             auto var = new llvm::GlobalVariable(
-                    IR::ctx.module,
+                    IR::ctx->module,
                     TypeSystem::get(type, convertArraySize(def->size)),
                     false,
                     llvm::GlobalValue::LinkageTypes::InternalLinkage,
@@ -96,7 +96,7 @@ llvm::Value *AST::VariableDecl::codeGen() {
             );
 
             // 将全局变量插入符号表
-            IR::ctx.symbolTable.insert(def->name, var);
+            IR::ctx->symbolTable.insert(def->name, var);
 
             // 初始化
             if (def->initVal) {
@@ -150,9 +150,14 @@ llvm::Value *AST::FunctionDef::codeGen() {
                 llvm::Function::ExternalLinkage :
                 llvm::Function::InternalLinkage,
             name,
-            IR::ctx.module
+            IR::ctx->module
     );
 
+    // main函数由C运行时调用，需要遵循目标平台的调用约定
+    if (name == "main") {
+        fixIntegerExtension(function);
+    }
+
     // 设置参数名
     size_t i = 0;
     for (auto &arg: function->args()) {
@@ -161,36 +166,42 @@ llvm::Value *AST::FunctionDef::codeGen() {
 
     // 创建入口基本块
     llvm::BasicBlock *entryBlock = llvm::BasicBlock::Create(
-            IR::ctx.llvmCtx,
+            IR::ctx->llvmCtx,
             "entry",
             function
     );
 
     // 设置当前插入点
-    IR::ctx.builder.SetInsertPoint(entryBlock);
+    IR::ctx->builder.SetInsertPoint(entryBlock);
 
     // 进入新的作用域
-    IR::ctx.function = function;
-    IR::ctx.symbolTable.push();
+    IR::ctx->function = function;
+    IR::ctx->constantLoop = false;
+    IR::ctx->symbolTable.push();
 
     // 为参数开空间，并保存在符号表中
     i = 0;
     for (auto &arg: function->args()) {
-        llvm::AllocaInst *alloca = IR::ctx.builder.CreateAlloca(
+        llvm::AllocaInst *alloca = IR::ctx->builder.CreateAlloca(
                 arg.getType(),
                 nullptr,
                 arg.getName()
         );
-        IR::ctx.builder.CreateStore(&arg, alloca);
-        IR::ctx.symbolTable.insert(arguments[i++]->name, alloca);
+        createStore(&arg, alloca);
+        IR::ctx->symbolTable.insert(arguments[i++]->name, alloca);
     }
 
     // 生成函数体代码
     body->codeGen();
 
     // 退出作用域
-    IR::ctx.symbolTable.pop();
-    IR::ctx.function = nullptr;
+    IR::ctx->symbolTable.pop();
+    IR::ctx->function = nullptr;
+
+    // 与C11相同，条件不是常量的循环可以假定会终止（没有副作用的死循环可以删除）
+    if (!IR::ctx->constantLoop) {
+        function->addFnAttr(llvm::Attribute::MustProgress);
+    }
 
     // 对没有返回值的分支加入默认返回值
     for (auto &BB : function->getBasicBlockList()) {
@@ -198,11 +209,11 @@ llvm::Value *AST::FunctionDef::codeGen() {
             continue;
         }
 
-        IR::ctx.builder.SetInsertPoint(&BB);
+        IR::ctx->builder.SetInsertPoint(&BB);
         if (returnType == Typename::VOID) {
-            IR::ctx.builder.CreateRetVoid();
+            IR::ctx->builder.CreateRetVoid();
         } else {
-            IR::ctx.builder.CreateRet(
+            IR::ctx->builder.CreateRet(
                     llvm::UndefValue::get(TypeSystem::get(returnType))
             );
         }
@@ -232,7 +243,7 @@ llvm::Value *AST::AssignStmt::codeGen() {
         rhs = TypeSystem::cast(rhs, lType);
     }
 
-    IR::ctx.builder.CreateStore(rhs, lhs);
+    createStore(rhs, lhs);
 
     // SysY中的赋值语句没有值，因此返回空指针即可
     return nullptr;
@@ -250,11 +261,11 @@ llvm::Value *AST::ExprStmt::codeGen() {
 
 llvm::Value *AST::BlockStmt::codeGen() {
     // 块语句需要开启新一层作用域
-    IR::ctx.symbolTable.push();
+    IR::ctx->symbolTable.push();
     for (Base *element: elements) {
         element->codeGen();
     }
-    IR::ctx.symbolTable.pop();
+    IR::ctx->symbolTable.pop();
     return nullptr;
 }
 
@@ -265,12 +276,12 @@ llvm::Value *AST::IfStmt::codeGen() {
     // 隐式类型转换
     value = unaryExprTypeFix(value, Typename::BOOL);
 
-    llvm::Function *function = IR::ctx.builder.GetInsertBlock()->getParent();
-    llvm::BasicBlock *thenBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "then");
-    llvm::BasicBlock *elseBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "else");
-    llvm::BasicBlock *mergeBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "merge");
+    llvm::Function *function = IR::ctx->builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock *thenBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "then");
+    llvm::BasicBlock *elseBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "else");
+    llvm::BasicBlock *mergeBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "merge");
 
-    IR::ctx.builder.CreateCondBr(value, thenBB, elseBB);
+    IR::ctx->builder.CreateCondBr(value, thenBB, elseBB);
 
     // merge块不一定是需要的
     // 仅当if或else分支需要跳转到merge块的时候，才会将merge块放到函数中
@@ -278,28 +289,28 @@ llvm::Value *AST::IfStmt::codeGen() {
 
     // 真分支
     function->getBasicBlockList().push_back(thenBB);
-    IR::ctx.builder.SetInsertPoint(thenBB);
+    IR::ctx->builder.SetInsertPoint(thenBB);
     thenStmt->codeGen();
     // 如果插入点还存在，说明没有产生return
     // 此时创建无条件指令跳转到merge块
-    if (IR::ctx.builder.GetInsertBlock()) {
+    if (IR::ctx->builder.GetInsertBlock()) {
         needMergeBB = true;
-        IR::ctx.builder.CreateBr(mergeBB);
+        IR::ctx->builder.CreateBr(mergeBB);
     }
 
     // 假分支
     // if, if-else 均有假分支，if的假分支直接跳转到merge基本块
     // 让pass来帮我们优化吧
     function->getBasicBlockList().push_back(elseBB);
-    IR::ctx.builder.SetInsertPoint(elseBB);
+    IR::ctx->builder.SetInsertPoint(elseBB);
     if (elseStmt) {
         elseStmt->codeGen();
     }
     // 如果插入点还存在，说明没有产生return
     // 此时创建无条件指令跳转到merge块
-    if (IR::ctx.builder.GetInsertBlock()) {
+    if (IR::ctx->builder.GetInsertBlock()) {
         needMergeBB = true;
-        IR::ctx.builder.CreateBr(mergeBB);
+        IR::ctx->builder.CreateBr(mergeBB);
     }
 
     // 合并块
@@ -307,7 +318,7 @@ llvm::Value *AST::IfStmt::codeGen() {
     // 在这种情况下，merge块是不需要的
     if (needMergeBB) {
         function->getBasicBlockList().push_back(mergeBB);
-        IR::ctx.builder.SetInsertPoint(mergeBB);
+        IR::ctx->builder.SetInsertPoint(mergeBB);
     }
 
     return nullptr;
@@ -338,20 +349,20 @@ llvm::Value *AST::WhileStmt::codeGen() {
     // cont:                 <----+
     //
 
-    if (!IR::ctx.builder.GetInsertBlock()) {
+    if (!IR::ctx->builder.GetInsertBlock()) {
         return nullptr;
     }
 
-    llvm::Function *function = IR::ctx.builder.GetInsertBlock()->getParent();
-    llvm::BasicBlock *conditionBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "cond");
-    llvm::BasicBlock *bodyBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "body");
-    llvm::BasicBlock *continueBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "cont");
+    llvm::Function *function = IR::ctx->builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock *conditionBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "cond");
+    llvm::BasicBlock *bodyBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "body");
+    llvm::BasicBlock *continueBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "cont");
 
-    IR::ctx.builder.CreateBr(conditionBB);
+    IR::ctx->builder.CreateBr(conditionBB);
 
     // condition基本块
     function->getBasicBlockList().push_back(conditionBB);
-    IR::ctx.builder.SetInsertPoint(conditionBB);
+    IR::ctx->builder.SetInsertPoint(conditionBB);
 
     // 计算条件表达式
     llvm::Value *value = condition->codeGen();
@@ -362,80 +373,84 @@ llvm::Value *AST::WhileStmt::codeGen() {
         value = TypeSystem::cast(value, Typename::BOOL);
     }
 
+    if (llvm::isa<llvm::Constant>(value)) {
+        IR::ctx->constantLoop = true;
+    }
+
     // 跳转到body基本块
-    IR::ctx.builder.CreateCondBr(value, bodyBB, continueBB);
+    IR::ctx->builder.CreateCondBr(value, bodyBB, continueBB);
 
     // body基本块
     function->getBasicBlockList().push_back(bodyBB);
-    IR::ctx.builder.SetInsertPoint(bodyBB);
+    IR::ctx->builder.SetInsertPoint(bodyBB);
 
     // 生成body语句
-    IR::ctx.loops.push({conditionBB, continueBB});
+    IR::ctx->loops.push({conditionBB, continueBB});
     body->codeGen();
-    IR::ctx.loops.pop();
+    IR::ctx->loops.pop();
 
-    if (IR::ctx.builder.GetInsertBlock()) {
+    if (IR::ctx->builder.GetInsertBlock()) {
         // 跳转到condition基本块
-        IR::ctx.builder.CreateBr(conditionBB);
+        IR::ctx->builder.CreateBr(conditionBB);
     }
 
     // 出了循环后的后继基本块
     function->getBasicBlockList().push_back(continueBB);
-    IR::ctx.builder.SetInsertPoint(continueBB);
+    IR::ctx->builder.SetInsertPoint(continueBB);
 
     return nullptr;
 }
 
 llvm::Value *AST::BreakStmt::codeGen() {
-    if (IR::ctx.loops.empty()) {
+    if (IR::ctx->loops.empty()) {
         throw std::runtime_error("break statement outside of loop");
     }
 
-    if (!IR::ctx.builder.GetInsertBlock()) {
+    if (!IR::ctx->builder.GetInsertBlock()) {
         return nullptr;
     }
 
     // 无条件跳出循环，并清除原循环中的插入点
-    IR::ctx.builder.CreateBr(IR::ctx.loops.top().breakBB);
+    IR::ctx->builder.CreateBr(IR::ctx->loops.top().breakBB);
 
-    IR::ctx.builder.ClearInsertionPoint();
+    IR::ctx->builder.ClearInsertionPoint();
     return nullptr;
 }
 
 llvm::Value *AST::ContinueStmt::codeGen() {
-    if (IR::ctx.loops.empty()) {
+    if (IR::ctx->loops.empty()) {
         throw std::runtime_error("break statement outside of loop");
     }
 
-    if (!IR::ctx.builder.GetInsertBlock()) {
+    if (!IR::ctx->builder.GetInsertBlock()) {
         return nullptr;
     }
 
     // 跳转执行下一次循环，并清除原循环中的插入点
-    IR::ctx.builder.CreateBr(IR::ctx.loops.top().continueBB);
+    IR::ctx->builder.CreateBr(IR::ctx->loops.top().continueBB);
 
-    IR::ctx.builder.ClearInsertionPoint();
+    IR::ctx->builder.ClearInsertionPoint();
     return nullptr;
 }
 
 llvm::Value *AST::ReturnStmt::codeGen() {
     // 如果插入点已经被clear，说明该基本块已经产生了return指令
     // 则不再插入return指令，直接返回
-    if (!IR::ctx.builder.GetInsertBlock()) {
+    if (!IR::ctx->builder.GetInsertBlock()) {
         return nullptr;
     }
 
     if (expr) {
         // 返回值隐式类型转换
-        Typename wantType = TypeSystem::from(IR::ctx.function->getReturnType());
+        Typename wantType = TypeSystem::from(IR::ctx->function->getReturnType());
         llvm::Value *value = unaryExprTypeFix(expr->codeGen(), wantType);
-        IR::ctx.builder.CreateRet(value);
+        IR::ctx->builder.CreateRet(value);
     } else {
-        IR::ctx.builder.CreateRetVoid();
+        IR::ctx->builder.CreateRetVoid();
     }
 
     // 丢弃后续的IR
-    IR::ctx.builder.ClearInsertionPoint();
+    IR::ctx->builder.ClearInsertionPoint();
 
     return nullptr;
 }
@@ -452,15 +467,15 @@ llvm::Value *AST::UnaryExpr::codeGen() {
             auto [valueFix, newType] =
                     unaryExprTypeFix(value, Typename::INT, Typename::FLOAT);
             if (newType == Typename::INT) {
-                return IR::ctx.builder.CreateNeg(valueFix);
+                return IR::ctx->builder.CreateNeg(valueFix);
             }
             if (newType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFNeg(valueFix);
+                return IR::ctx->builder.CreateFNeg(valueFix);
             }
         }
         case Operator::NOT: {
             auto valueFix = unaryExprTypeFix(value, Typename::BOOL);
-            return IR::ctx.builder.CreateNot(valueFix);
+            return IR::ctx->builder.CreateNot(valueFix);
         }
     }
     throw std::logic_error(
@@ -472,7 +487,7 @@ llvm::Value *AST::UnaryExpr::codeGen() {
 llvm::Value *AST::FunctionCallExpr::codeGen() {
     // 由于函数不涉及到分层问题，因此并没有存储在自建符号表中
     // 直接使用llvm module中的函数表即可
-    llvm::Function *function = IR::ctx.module.getFunction(name);
+    llvm::Function *function = IR::ctx->module.getFunction(name);
 
     // 合法性检查
     if (!function) {
@@ -503,7 +518,7 @@ llvm::Value *AST::FunctionCallExpr::codeGen() {
     }
 
     // 调用函数
-    return IR::ctx.builder.CreateCall(function, values);
+    return IR::ctx->builder.CreateCall(function, values);
 }
 
 
@@ -519,10 +534,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateAdd(LFix, RFix);
+                return IR::ctx->builder.CreateAdd(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFAdd(LFix, RFix);
+                return IR::ctx->builder.CreateFAdd(LFix, RFix);
             }
         }
         case Operator::SUB: {
@@ -531,10 +546,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateSub(LFix, RFix);
+                return IR::ctx->builder.CreateSub(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFSub(LFix, RFix);
+                return IR::ctx->builder.CreateFSub(LFix, RFix);
             }
         }
         case Operator::MUL: {
@@ -543,10 +558,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateMul(LFix, RFix);
+                return IR::ctx->builder.CreateMul(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFMul(LFix, RFix);
+                return IR::ctx->builder.CreateFMul(LFix, RFix);
             }
         }
         case Operator::DIV: {
@@ -555,10 +570,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateSDiv(LFix, RFix);
+                return IR::ctx->builder.CreateSDiv(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFDiv(LFix, RFix);
+                return IR::ctx->builder.CreateFDiv(LFix, RFix);
             }
         }
         case Operator::MOD: {
@@ -567,7 +582,7 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateSRem(LFix, RFix);
+                return IR::ctx->builder.CreateSRem(LFix, RFix);
             }
             throw std::runtime_error("invalid type for operator %");
         }
@@ -592,39 +607,39 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             // <PHI>
             //
 
-            if (!IR::ctx.builder.GetInsertBlock()) {
+            if (!IR::ctx->builder.GetInsertBlock()) {
                 return nullptr;
             }
 
-            llvm::Function *function = IR::ctx.builder.GetInsertBlock()->getParent();
-            llvm::BasicBlock *andBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "and");
-            llvm::BasicBlock *mergeBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "andm");
+            llvm::Function *function = IR::ctx->builder.GetInsertBlock()->getParent();
+            llvm::BasicBlock *andBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "and");
+            llvm::BasicBlock *mergeBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "andm");
 
             // 左侧表达式一定会生成
             llvm::Value *L = lhs->codeGen();
             L = unaryExprTypeFix(L, Typename::BOOL);
-            IR::ctx.builder.CreateCondBr(L, andBB, mergeBB);
-            auto incoming1 = IR::ctx.builder.GetInsertBlock();
+            IR::ctx->builder.CreateCondBr(L, andBB, mergeBB);
+            auto incoming1 = IR::ctx->builder.GetInsertBlock();
 
             // 生成右侧表达式
             function->getBasicBlockList().push_back(andBB);
-            IR::ctx.builder.SetInsertPoint(andBB);
+            IR::ctx->builder.SetInsertPoint(andBB);
 
             llvm::Value *R = rhs->codeGen();
             R = unaryExprTypeFix(R, Typename::BOOL);
-            IR::ctx.builder.CreateBr(mergeBB);
-            auto incoming2 = IR::ctx.builder.GetInsertBlock();
+            IR::ctx->builder.CreateBr(mergeBB);
+            auto incoming2 = IR::ctx->builder.GetInsertBlock();
 
             // 生成合并块
             function->getBasicBlockList().push_back(mergeBB);
-            IR::ctx.builder.SetInsertPoint(mergeBB);
-            llvm::PHINode *phi = IR::ctx.builder.CreatePHI(
-                    llvm::Type::getInt1Ty(IR::ctx.llvmCtx), 2
+            IR::ctx->builder.SetInsertPoint(mergeBB);
+            llvm::PHINode *phi = IR::ctx->builder.CreatePHI(
+                    llvm::Type::getInt1Ty(IR::ctx->llvmCtx), 2
             );
 
             // 生成合并块的phi节点，将左右两侧的值传入
             // incoming1分支传入的值一定为false
-            phi->addIncoming(llvm::ConstantInt::getFalse(IR::ctx.llvmCtx), incoming1);
+            phi->addIncoming(llvm::ConstantInt::getFalse(IR::ctx->llvmCtx), incoming1);
             phi->addIncoming(R, incoming2);
 
             return phi;
@@ -648,39 +663,39 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             // <PHI>
             //
 
-            if (!IR::ctx.builder.GetInsertBlock()) {
+            if (!IR::ctx->builder.GetInsertBlock()) {
                 return nullptr;
             }
 
-            llvm::Function *function = IR::ctx.builder.GetInsertBlock()->getParent();
-            llvm::BasicBlock *orBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "or");
-            llvm::BasicBlock *mergeBB = llvm::BasicBlock::Create(IR::ctx.llvmCtx, "orm");
+            llvm::Function *function = IR::ctx->builder.GetInsertBlock()->getParent();
+            llvm::BasicBlock *orBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "or");
+            llvm::BasicBlock *mergeBB = llvm::BasicBlock::Create(IR::ctx->llvmCtx, "orm");
 
             // 左侧表达式一定会生成
             llvm::Value *L = lhs->codeGen();
             L = unaryExprTypeFix(L, Typename::BOOL);
-            IR::ctx.builder.CreateCondBr(L, mergeBB, orBB);
-            auto incoming1 = IR::ctx.builder.GetInsertBlock();
+            IR::ctx->builder.CreateCondBr(L, mergeBB, orBB);
+            auto incoming1 = IR::ctx->builder.GetInsertBlock();
 
             // 生成右侧表达式
             function->getBasicBlockList().push_back(orBB);
-            IR::ctx.builder.SetInsertPoint(orBB);
+            IR::ctx->builder.SetInsertPoint(orBB);
 
             llvm::Value *R = rhs->codeGen();
             R = unaryExprTypeFix(R, Typename::BOOL);
-            IR::ctx.builder.CreateBr(mergeBB);
-            auto incoming2 = IR::ctx.builder.GetInsertBlock();
+            IR::ctx->builder.CreateBr(mergeBB);
+            auto incoming2 = IR::ctx->builder.GetInsertBlock();
 
             // 生成合并块
             function->getBasicBlockList().push_back(mergeBB);
-            IR::ctx.builder.SetInsertPoint(mergeBB);
-            llvm::PHINode *phi = IR::ctx.builder.CreatePHI(
-                    llvm::Type::getInt1Ty(IR::ctx.llvmCtx), 2
+            IR::ctx->builder.SetInsertPoint(mergeBB);
+            llvm::PHINode *phi = IR::ctx->builder.CreatePHI(
+                    llvm::Type::getInt1Ty(IR::ctx->llvmCtx), 2
             );
 
             // 生成合并块的phi节点，将左右两侧的值传入
             // incoming1分支传入的值一定为true
-            phi->addIncoming(llvm::ConstantInt::getTrue(IR::ctx.llvmCtx), incoming1);
+            phi->addIncoming(llvm::ConstantInt::getTrue(IR::ctx->llvmCtx), incoming1);
             phi->addIncoming(R, incoming2);
 
             return phi;
@@ -693,10 +708,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateICmpSLT(LFix, RFix);
+                return IR::ctx->builder.CreateICmpSLT(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFCmpOLT(LFix, RFix);
+                return IR::ctx->builder.CreateFCmpOLT(LFix, RFix);
             }
         }
         case Operator::LE: {
@@ -705,10 +720,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateICmpSLE(LFix, RFix);
+                return IR::ctx->builder.CreateICmpSLE(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFCmpOLE(LFix, RFix);
+                return IR::ctx->builder.CreateFCmpOLE(LFix, RFix);
             }
         }
         case Operator::GT: {
@@ -717,10 +732,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateICmpSGT(LFix, RFix);
+                return IR::ctx->builder.CreateICmpSGT(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFCmpOGT(LFix, RFix);
+                return IR::ctx->builder.CreateFCmpOGT(LFix, RFix);
             }
         }
         case Operator::GE: {
@@ -729,10 +744,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateICmpSGE(LFix, RFix);
+                return IR::ctx->builder.CreateICmpSGE(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFCmpOGE(LFix, RFix);
+                return IR::ctx->builder.CreateFCmpOGE(LFix, RFix);
             }
         }
         case Operator::EQ: {
@@ -741,10 +756,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateICmpEQ(LFix, RFix);
+                return IR::ctx->builder.CreateICmpEQ(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFCmpOEQ(LFix, RFix);
+                return IR::ctx->builder.CreateFCmpOEQ(LFix, RFix);
             }
         }
         case Operator::NE: {
@@ -753,10 +768,10 @@ llvm::Value *AST::BinaryExpr::codeGen() {
             auto [LFix, RFix, nodeType] =
                     binaryExprTypeFix(L, R, Typename::INT, Typename::FLOAT);
             if (nodeType == Typename::INT) {
-                return IR::ctx.builder.CreateICmpNE(LFix, RFix);
+                return IR::ctx->builder.CreateICmpNE(LFix, RFix);
             }
             if (nodeType == Typename::FLOAT) {
-                return IR::ctx.builder.CreateFCmpONE(LFix, RFix);
+                return IR::ctx->builder.CreateFCmpONE(LFix, RFix);
             }
         }
     }
@@ -770,12 +785,12 @@ llvm::Value *AST::BinaryExpr::codeGen() {
 llvm::Value *AST::NumberExpr::codeGen() {
     if (std::holds_alternative<int>(value)) {
         return llvm::ConstantInt::get(
-                llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+                llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
                 std::get<int>(value)
         );
     } else {
         return llvm::ConstantFP::get(
-                llvm::Type::getFloatTy(IR::ctx.llvmCtx),
+                llvm::Type::getFloatTy(IR::ctx->llvmCtx),
                 std::get<float>(value)
         );
     }
@@ -786,15 +801,15 @@ llvm::Value *AST::VariableExpr::codeGen() {
     // 数组使用指针传参
     // 普遍变量使用值传参
     if (var->getType()->getPointerElementType()->isArrayTy()) {
-        return IR::ctx.builder.CreateGEP(
+        return IR::ctx->builder.CreateGEP(
                 var->getType()->getPointerElementType(),
                 var,
                 {
-                        llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx.llvmCtx), 0),
-                        llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx.llvmCtx), 0)
+                        llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx->llvmCtx), 0),
+                        llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx->llvmCtx), 0)
                 }
         );
     } else {
-        return IR::ctx.builder.CreateLoad(var->getType()->getPointerElementType(), var);
+        return createLoad(var->getType()->getPointerElementType(), var);
     }
 }
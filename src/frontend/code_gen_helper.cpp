@@ -2,6 +2,8 @@
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include "AST.h"
 #include "IR.h"
 #include "type.h"
@@ -149,11 +151,11 @@ CodeGenHelper::getGEPIndices(
 ) {
     std::vector<llvm::Value *> GEPIndices;
     GEPIndices.emplace_back(
-            llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx.llvmCtx), 0)
+            llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx->llvmCtx), 0)
     );
     for (int index: indices) {
         GEPIndices.emplace_back(
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx.llvmCtx), index)
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(IR::ctx->llvmCtx), index)
         );
     }
     return GEPIndices;
@@ -167,7 +169,7 @@ CodeGenHelper::dynamicInitValCodeGen(
 ) {
     if (std::holds_alternative<AST::Expr *>(initializerElement->element)) {
         auto val = std::get<AST::Expr *>(initializerElement->element)->codeGen();
-        auto var = IR::ctx.builder.CreateGEP(
+        auto var = IR::ctx->builder.CreateGEP(
                 alloca->getType()->getPointerElementType(),
                 alloca,
                 getGEPIndices(indices)
@@ -175,7 +177,7 @@ CodeGenHelper::dynamicInitValCodeGen(
         // 普通数组初值隐式类型转换
         Typename wantType = TypeSystem::from(var->getType()->getPointerElementType());
         val = unaryExprTypeFix(val, wantType);
-        IR::ctx.builder.CreateStore(val, var);
+        createStore(val, var);
         return;
     }
 
@@ -202,7 +204,7 @@ CodeGenHelper::getVariablePointer(
         const std::string &name,
         const std::vector<AST::Expr *> &size
 ) {
-    llvm::Value *var = IR::ctx.symbolTable.lookup(name);
+    llvm::Value *var = IR::ctx->symbolTable.lookup(name);
 
     // 计算维度
     std::vector<llvm::Value *> indices;
@@ -213,22 +215,22 @@ CodeGenHelper::getVariablePointer(
     // 寻址
     for (auto index: indices) {
         if (var->getType()->getPointerElementType()->isPointerTy()) {
-            var = IR::ctx.builder.CreateLoad(
+            var = createLoad(
                     var->getType()->getPointerElementType(),
                     var
             );
-            var = IR::ctx.builder.CreateGEP(
+            var = IR::ctx->builder.CreateGEP(
                     var->getType()->getPointerElementType(),
                     var,
                     index
             );
         } else {
-            var = IR::ctx.builder.CreateGEP(
+            var = IR::ctx->builder.CreateGEP(
                     var->getType()->getPointerElementType(),
                     var,
                     {
                             llvm::ConstantInt::get(
-                                    llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+                                    llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
                                     0
                             ),
                             index
@@ -238,3 +240,51 @@ CodeGenHelper::getVariablePointer(
     }
     return var;
 }
+
+llvm::MDNode *
+CodeGenHelper::getTBAATag(
+        llvm::Type *type,
+        llvm::Value *ptr
+) {
+    // MDNode由LLVMContext唯一化，重复构造得到的是同一个节点
+    llvm::MDBuilder mdBuilder(IR::ctx->llvmCtx);
+    llvm::MDNode *root = mdBuilder.createTBAARoot("SysY TBAA");
+
+    llvm::MDNode *node;
+    if (type->isPointerTy()) {
+        node = mdBuilder.createTBAAScalarTypeNode("pointer", root);
+    } else if (type->isFloatTy()) {
+        node = mdBuilder.createTBAAScalarTypeNode("float", root);
+    } else {
+        node = mdBuilder.createTBAAScalarTypeNode("int", root);
+    }
+
+    // 地址的基对象为全局变量时，使用该全局变量的节点
+    // 越界访问是未定义行为，因此直接访问某个全局变量的指令不会访问到其他全局变量
+    llvm::Value *base = llvm::getUnderlyingObject(ptr, 0);
+    if (auto global = llvm::dyn_cast<llvm::GlobalVariable>(base)) {
+        node = mdBuilder.createTBAAScalarTypeNode(global->getName(), node);
+    }
+
+    return mdBuilder.createTBAAStructTagNode(node, node, 0);
+}
+
+llvm::LoadInst *
+CodeGenHelper::createLoad(
+        llvm::Type *type,
+        llvm::Value *ptr
+) {
+    llvm::LoadInst *load = IR::ctx->builder.CreateLoad(type, ptr);
+    load->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag(type, ptr));
+    return load;
+}
+
+llvm::StoreInst *
+CodeGenHelper::createStore(
+        llvm::Value *value,
+        llvm::Value *ptr
+) {
+    llvm::StoreInst *store = IR::ctx->builder.CreateStore(value, ptr);
+    store->setMetadata(llvm::LLVMContext::MD_tbaa, getTBAATag(value->getType(), ptr));
+    return store;
+}
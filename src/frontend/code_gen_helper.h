@@ -5,6 +5,7 @@
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
 #include "AST.h"
 #include "type.h"
 
@@ -77,6 +78,29 @@ namespace CodeGenHelper {
             const std::vector<AST::Expr *> &size
     );
 
+    // 获取访存指令的TBAA标签
+    // 类型树：int、float与数组参数指针互不重叠；每个全局变量是其元素类型的子节点，
+    // 直接访问不同全局变量的指令互不重叠，经数组参数的访问（标签为元素类型）与所有同类型全局变量可能重叠
+    llvm::MDNode *
+    getTBAATag(
+            llvm::Type *type,
+            llvm::Value *ptr
+    );
+
+    // 生成带TBAA标签的load
+    llvm::LoadInst *
+    createLoad(
+            llvm::Type *type,
+            llvm::Value *ptr
+    );
+
+    // 生成带TBAA标签的store
+    llvm::StoreInst *
+    createStore(
+            llvm::Value *value,
+            llvm::Value *ptr
+    );
+
 }
 
 #endif //SYSY_COMPILER_FRONTEND_CODE_GEN_HELPER_H
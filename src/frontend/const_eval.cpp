@@ -6,13 +6,11 @@
 #include "symbol_table.h"
 #include "mem.h"
 #include "AST.h"
+#include "IR.h"
 #include "const_eval_helper.h"
 
 using namespace ConstEvalHelper;
 
-// 常量求值符号表，仅存储普通常量，不存储数组常量
-static SymbolTable<std::variant<int, float> *> constEvalSymTable;
-
 void AST::CompileUnit::constEval(AST::Base *&root) {
     // 注意这个&，由于是引用，所以可以递归修改子树指针
     for (Base* &compileElement: compileElements) {
@@ -74,7 +72,7 @@ void AST::ConstVariableDecl::constEval(AST::Base *&root) {
             );
 
             // 在常量表中插入常量，在后续常量求值中可能会使用
-            constEvalSymTable.insert(
+            IR::ctx->constEvalSymTable.insert(
                     def->name,
                     Memory::make<std::variant<int, float>>(numberExpr->value)
             );
@@ -133,14 +131,14 @@ void AST::Block::constEval(AST::Base *&root) {
 
 void AST::FunctionDef::constEval(AST::Base *&root) {
     // 创建该函数专属的局部符号表
-    constEvalSymTable.push();
+    IR::ctx->constEvalSymTable.push();
 
     for (FunctionArg* &argument: arguments) {
         constEvalHelper(argument);
     }
     constEvalHelper(body);
 
-    constEvalSymTable.pop();
+    IR::ctx->constEvalSymTable.pop();
 }
 
 void AST::AssignStmt::constEval(AST::Base *&root) {
@@ -156,13 +154,13 @@ void AST::NullStmt::constEval(AST::Base *&root) {
 }
 
 void AST::BlockStmt::constEval(AST::Base *&root) {
-    constEvalSymTable.push();
+    IR::ctx->constEvalSymTable.push();
 
     for (Base* &element: elements) {
         constEvalHelper(element);
     }
 
-    constEvalSymTable.pop();
+    IR::ctx->constEvalSymTable.pop();
 }
 
 void AST::IfStmt::constEval(AST::Base *&root) {
@@ -326,7 +324,7 @@ void AST::NumberExpr::constEval(AST::Base *&root) {
 
 void AST::VariableExpr::constEval(AST::Base *&root) {
     // 从符号表中查找编译期常量
-    std::variant<int, float> *pValue = constEvalSymTable.tryLookup(name);
+    std::variant<int, float> *pValue = IR::ctx->constEvalSymTable.tryLookup(name);
     if (!pValue) {
         return;
     }
@@ -2,10 +2,12 @@
 #define SYSY_COMPILER_FRONTEND_CONTEXT_H
 
 #include <stack>
+#include <variant>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 #include "symbol_table.h"
+#include "mem.h"
 #include "loop_info.h"
 
 // 用于IR生成的context
@@ -22,11 +24,21 @@ struct Context {
     // 循环信息栈，记录嵌套循环，用于continue/break
     std::stack<LoopInfo> loops;
 
+    // 当前函数中是否有条件为常量的循环（如while (1)），这样的循环不能假定会终止
+    bool constantLoop;
+
+    // 常量求值符号表，仅存储普通常量，不存储数组常量
+    SymbolTable<std::variant<int, float> *> constEvalSymTable;
+
+    // AST节点（Memory::make创建的对象）的内存
+    Memory::Arena arena;
+
     Context() : llvmCtx(),
                 module("SysY_src", llvmCtx),
                 builder(llvmCtx),
                 symbolTable(),
-                function(nullptr) {}
+                function(nullptr),
+                constantLoop(false) {}
 };
 
 #endif //SYSY_COMPILER_FRONTEND_CONTEXT_H
@@ -1,7 +1,7 @@
+#include <functional>
 #include <optional>
 #include <string>
 #include <regex>
-#include <mutex>
 #include <iomanip>
 #include <utility>
 #include "log.h"
@@ -16,13 +16,13 @@
 
 struct Pattern {
     const std::string regex;
-    const std::function<std::optional<int>(std::string)> callback;
+    const std::function<std::optional<int>(Lexer &, YYSTYPE &, std::string)> callback;
 
     static std::string fixGroup(const std::string &pattern);
 
     Pattern(
             const std::string &pattern,
-            std::function<std::optional<int>(std::string)> callback
+            std::function<std::optional<int>(Lexer &, YYSTYPE &, std::string)> callback
     );
 };
 
@@ -42,13 +42,9 @@ std::string Pattern::fixGroup(const std::string &pattern) {
 }
 
 Pattern::Pattern(const std::string &pattern,
-                 std::function<std::optional<int>(std::string)> callback)
+                 std::function<std::optional<int>(Lexer &, YYSTYPE &, std::string)> callback)
         : regex(fixGroup(pattern)), callback(std::move(callback)) {}
 
-// 记录行号，列号
-static size_t currRow = 1;
-static size_t currCol = 1;
-
 // 包含patterns数组
 // getToken函数通过从上到下遍历patterns数组，匹配第一个匹配的pattern
 // 然后调用其对应的callback，获得token的类型
@@ -68,25 +64,38 @@ void Lexer::changeRowCol(const std::string &str, size_t &row, size_t &col) {
     }
 }
 
-// https://stackoverflow.com/questions/34229328/writing-a-very-simple-lexical-analyser-in-c
-std::optional<int> Lexer::getToken() {
-
-    static std::once_flag onceFlag;
-
-    std::call_once(onceFlag, [this] {
-        // 按序合并所有正则表达式
+// 按序合并所有正则表达式并编译，整个进程只编译一次，所有Lexer实例共享
+static const std::regex &mergedRegex() {
+    static const std::regex regex = [] {
         std::string regexMerge;
         for (const Pattern &pattern: patterns) {
             regexMerge += "(" + pattern.regex + ")|";
         }
         // 去除最后一个竖线
         regexMerge.pop_back();
-        // 编译正则表达式
-        regex = std::regex(regexMerge);
-        it = std::sregex_iterator(input.begin(), input.end(), regex);
-        end = std::sregex_iterator();
-    });
+        return std::regex(regexMerge);
+    }();
+    return regex;
+}
+
+Lexer::Lexer(std::string input) : input(std::move(input)) {
+    it = std::sregex_iterator(this->input.begin(), this->input.end(), mergedRegex());
 
+    // 打印表头
+    ::log("lexer") <<
+                   std::setw(20) << "token" <<
+                   std::setw(20) << "lexeme" <<
+                   std::setw(10) << "line" <<
+                   std::setw(10) << "column" <<
+                   std::endl;
+}
+
+void Lexer::initialize() {
+    mergedRegex();
+}
+
+// https://stackoverflow.com/questions/34229328/writing-a-very-simple-lexical-analyser-in-c
+std::optional<int> Lexer::getToken(YYSTYPE &yylval) {
     retry:
     if (it == end) {
         return std::nullopt;
@@ -95,7 +104,7 @@ std::optional<int> Lexer::getToken() {
     for (int i = 0; i < it->size(); i++) {
         if ((*it)[i + 1].matched) {
             std::string str = (*it)[i + 1].str();
-            std::optional<int> token = patterns[i].callback(str);
+            std::optional<int> token = patterns[i].callback(*this, yylval, str);
             changeRowCol(str, currRow, currCol);
             it++;
             if (token) {
@@ -109,7 +118,7 @@ std::optional<int> Lexer::getToken() {
     throw std::logic_error("unknown token exception not handled");
 }
 
-void Lexer::log(const std::string &token, const std::string &lexeme, void *ptr) {
+void Lexer::log(const std::string &token, const std::string &lexeme, void *ptr) const {
     auto &stream = ::log("lexer");
     stream << std::setw(20) << token <<
            std::setw(20) << lexeme <<
@@ -122,22 +131,8 @@ void Lexer::log(const std::string &token, const std::string &lexeme, void *ptr)
 }
 
 // 被yyparse调用
-int yylex() {
-    static std::string s(std::istreambuf_iterator(std::cin), {});
-    static Lexer lexer{s};
-
-    // 在开始词法分析时调用一次，打印表头
-    static std::once_flag onceFlag;
-    std::call_once(onceFlag, [] {
-        log("lexer") <<
-                     std::setw(20) << "token" <<
-                     std::setw(20) << "lexeme" <<
-                     std::setw(10) << "line" <<
-                     std::setw(10) << "column" <<
-                     std::endl;
-    });
-
-    if (std::optional<int> token = lexer.getToken()) {
+int yylex(YYSTYPE *yylvalp, Lexer &lexer) {
+    if (std::optional<int> token = lexer.getToken(*yylvalp)) {
         return *token;
     }
     return 0;
@@ -5,20 +5,41 @@
 #include <string>
 #include <utility>
 #include <regex>
+#include "position.h"
 
+// 语法分析器的语义值类型，定义在bison生成的parser.h中
+union YYSTYPE;
+
+// 词法分析器，每个源文件使用一个实例，作为参数传给yyparse
 class Lexer {
     std::string input;
     std::sregex_iterator it, end;
-    std::regex regex;
+
+    // 记录行号，列号
+    size_t currRow = 1;
+    size_t currCol = 1;
 
     static void changeRowCol(const std::string &str, size_t &row, size_t &col);
 
 public:
-    explicit Lexer(std::string input) : input(std::move(input)) {}
+    // 迭代器引用input中的字符，Lexer构造后不能复制或移动
+    explicit Lexer(std::string input);
+
+    Lexer(const Lexer &) = delete;
+
+    Lexer &operator=(const Lexer &) = delete;
+
+    // 预先编译词法规则的正则表达式（如编译服务器启动时），多次调用只会编译一次
+    static void initialize();
+
+    // 读取下一个token，语义值写入yylval，输入结束时返回std::nullopt
+    std::optional<int> getToken(YYSTYPE &yylval);
 
-    std::optional<int> getToken();
+    Position position() const {
+        return {currRow, currCol};
+    }
 
-    static void log(const std::string &token, const std::string &lexeme = "", void *ptr = nullptr);
+    void log(const std::string &token, const std::string &lexeme = "", void *ptr = nullptr) const;
 };
 
 #endif //SYSY_COMPILER_FRONTEND_LEXER_H
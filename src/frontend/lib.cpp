@@ -1,48 +1,74 @@
+#include <stdexcept>
+#include <string>
 #include <vector>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Function.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Transforms/IPO/Internalize.h>
 #include "IR.h"
+#include "target.h"
 #include "lib.h"
 
+// 输入输出函数只通过stdin/stdout访问程序不可见的内存，不抛出异常、总会返回，
+// 因此调用不会修改或读取程序中的全局变量与数组
+static void addStreamAttributes(llvm::Function *func) {
+    func->addFnAttr(llvm::Attribute::NoUnwind);
+    func->addFnAttr(llvm::Attribute::WillReturn);
+    func->addFnAttr(llvm::Attribute::InaccessibleMemOnly);
+}
+
+// 读写数组的输入输出函数还会访问数组参数指向的内存（只读或只写），但不保存指针
+static void addArrayStreamAttributes(llvm::Function *func, llvm::Argument *array, llvm::Attribute::AttrKind access) {
+    func->addFnAttr(llvm::Attribute::NoUnwind);
+    func->addFnAttr(llvm::Attribute::WillReturn);
+    func->addFnAttr(llvm::Attribute::InaccessibleMemOrArgMemOnly);
+    array->addAttr(llvm::Attribute::NoCapture);
+    array->addAttr(access);
+}
+
 // int getint()
 static void addGetintPrototype() {
     std::vector<llvm::Type *> argTypes;
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+            llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
             argTypes,
             false
     );
-    llvm::Function::Create(
+    llvm::Function *func = llvm::Function::Create(
             funcType,
             llvm::Function::ExternalLinkage,
             "getint",
-            IR::ctx.module
+            IR::ctx->module
     );
+    addStreamAttributes(func);
 }
 
 // int getch()
 static void addGetchPrototype() {
     std::vector<llvm::Type *> argTypes;
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+            llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
             argTypes,
             false
     );
-    llvm::Function::Create(
+    llvm::Function *func = llvm::Function::Create(
             funcType,
             llvm::Function::ExternalLinkage,
             "getch",
-            IR::ctx.module
+            IR::ctx->module
     );
+    addStreamAttributes(func);
 }
 
 // int getarray(int a[])
 static void addGetarrayPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32PtrTy(IR::ctx.llvmCtx)
+        llvm::Type::getInt32PtrTy(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+            llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -50,34 +76,36 @@ static void addGetarrayPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "getarray",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("a");
+    addArrayStreamAttributes(func, func->getArg(0), llvm::Attribute::WriteOnly);
 }
 
 // float getfloat()
 static void addGetfloatPrototype() {
     std::vector<llvm::Type *> argTypes;
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getFloatTy(IR::ctx.llvmCtx),
+            llvm::Type::getFloatTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
-    llvm::Function::Create(
+    llvm::Function *func = llvm::Function::Create(
             funcType,
             llvm::Function::ExternalLinkage,
             "getfloat",
-            IR::ctx.module
+            IR::ctx->module
     );
+    addStreamAttributes(func);
 }
 
 // int getfarray(float a[])
 static void addGetfarrayPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getFloatPtrTy(IR::ctx.llvmCtx)
+        llvm::Type::getFloatPtrTy(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+            llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -85,18 +113,19 @@ static void addGetfarrayPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "getfarray",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("a");
+    addArrayStreamAttributes(func, func->getArg(0), llvm::Attribute::WriteOnly);
 }
 
 // void putint(int a)
 static void addPutintPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32Ty(IR::ctx.llvmCtx)
+        llvm::Type::getInt32Ty(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -104,18 +133,19 @@ static void addPutintPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "putint",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("a");
+    addStreamAttributes(func);
 }
 
 // void putch(int a)
 static void addPutchPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32Ty(IR::ctx.llvmCtx)
+        llvm::Type::getInt32Ty(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -123,19 +153,20 @@ static void addPutchPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "putch",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("a");
+    addStreamAttributes(func);
 }
 
 // void putarray(int n, int a[])
 static void addPutarrayPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
-        llvm::Type::getInt32PtrTy(IR::ctx.llvmCtx)
+        llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
+        llvm::Type::getInt32PtrTy(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -143,19 +174,20 @@ static void addPutarrayPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "putarray",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("n");
     func->getArg(1)->setName("a");
+    addArrayStreamAttributes(func, func->getArg(1), llvm::Attribute::ReadOnly);
 }
 
 // void putfloat(float a)
 static void addPutfloatPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getFloatTy(IR::ctx.llvmCtx)
+        llvm::Type::getFloatTy(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -163,19 +195,20 @@ static void addPutfloatPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "putfloat",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("a");
+    addStreamAttributes(func);
 }
 
 // void putfarray(int n, float a[])
 static void addPutfarrayPrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
-        llvm::Type::getFloatPtrTy(IR::ctx.llvmCtx)
+        llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
+        llvm::Type::getFloatPtrTy(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -183,19 +216,20 @@ static void addPutfarrayPrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "putfarray",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("n");
     func->getArg(1)->setName("a");
+    addArrayStreamAttributes(func, func->getArg(1), llvm::Attribute::ReadOnly);
 }
 
 // void _sysy_starttime(int lineno)
 static void addSysyStarttimePrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32Ty(IR::ctx.llvmCtx)
+        llvm::Type::getInt32Ty(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -203,18 +237,20 @@ static void addSysyStarttimePrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "_sysy_starttime",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("lineno");
+    // 计时函数是计时区间的边界，不标注内存属性，避免程序中的访存被移出计时区间
+    func->addFnAttr(llvm::Attribute::NoUnwind);
 }
 
 // void _sysy_stoptime(int lineno)
 static void addSysyStoptimePrototype() {
     std::vector<llvm::Type *> argTypes{
-        llvm::Type::getInt32Ty(IR::ctx.llvmCtx)
+        llvm::Type::getInt32Ty(IR::ctx->llvmCtx)
     };
     llvm::FunctionType *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(IR::ctx.llvmCtx),
+            llvm::Type::getVoidTy(IR::ctx->llvmCtx),
             argTypes,
             false
     );
@@ -222,12 +258,35 @@ static void addSysyStoptimePrototype() {
             funcType,
             llvm::Function::ExternalLinkage,
             "_sysy_stoptime",
-            IR::ctx.module
+            IR::ctx->module
     );
     func->getArg(0)->setName("lineno");
+    // 同_sysy_starttime，不标注内存属性
+    func->addFnAttr(llvm::Attribute::NoUnwind);
+}
+
+// 按照目标平台的调用约定，为32位整数参数/返回值添加符号扩展属性
+void fixIntegerExtension(llvm::Function *func) {
+    llvm::Triple triple(IR::ctx->module.getTargetTriple());
+    if (!Target::extendsInt32(triple)) {
+        return;
+    }
+    if (func->getReturnType()->isIntegerTy(32)) {
+        func->addRetAttr(llvm::Attribute::SExt);
+    }
+    for (auto &arg: func->args()) {
+        if (arg.getType()->isIntegerTy(32)) {
+            arg.addAttr(llvm::Attribute::SExt);
+        }
+    }
 }
 
 void addLibraryPrototype() {
+    // 原型可能已经提前添加（计算编译缓存的键时）
+    if (IR::ctx->module.getFunction("getint")) {
+        return;
+    }
+
     addGetintPrototype();
     addGetchPrototype();
     addGetarrayPrototype();
@@ -240,4 +299,69 @@ void addLibraryPrototype() {
     addPutfarrayPrototype();
     addSysyStarttimePrototype();
     addSysyStoptimePrototype();
+
+    for (auto &func: IR::ctx->module.functions()) {
+        fixIntegerExtension(&func);
+    }
+}
+
+// 运行时库输入输出函数的bitcode，构建时由runtime_lib/sylib.ll生成
+static const unsigned char libraryBitcode[] = {
+#include "sylib_bitcode.inc"
+};
+
+void linkLibraryBitcode() {
+    llvm::Module &module = IR::ctx->module;
+
+    // 用户程序定义了库函数内部调用的同名函数时，不能链接
+    for (const char *name: {"printf", "scanf"}) {
+        llvm::Function *func = module.getFunction(name);
+        if (func && !func->isDeclaration()) {
+            return;
+        }
+    }
+
+    auto library = llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(
+                    llvm::StringRef(reinterpret_cast<const char *>(libraryBitcode), sizeof(libraryBitcode)),
+                    "sylib.bc"
+            ),
+            module.getContext()
+    );
+    if (!library) {
+        throw std::logic_error("invalid runtime library bitcode: " + llvm::toString(library.takeError()));
+    }
+    (*library)->setTargetTriple(module.getTargetTriple());
+    (*library)->setDataLayout(module.getDataLayout());
+
+    // sylib.ll中getch按有符号char扩展，char为无符号的平台上改为零扩展，与sylib.c编译的结果一致
+    if (Target::isCharUnsigned(llvm::Triple(module.getTargetTriple()))) {
+        if (llvm::Function *getch = (*library)->getFunction("getch")) {
+            for (llvm::BasicBlock &BB: *getch) {
+                for (llvm::Instruction &I: llvm::make_early_inc_range(BB)) {
+                    if (auto *ext = llvm::dyn_cast<llvm::SExtInst>(&I)) {
+                        auto *zext = new llvm::ZExtInst(ext->getOperand(0), ext->getType(), "", ext);
+                        zext->takeName(ext);
+                        ext->replaceAllUsesWith(zext);
+                        ext->eraseFromParent();
+                    }
+                }
+            }
+        }
+    }
+
+    // 只链接模块中声明了的库函数，链接的副本改为内部链接：
+    // 对外不可见，可执行文件中的同名函数仍由运行时库提供，未被调用的副本由优化器删除
+    if (llvm::Linker::linkModules(
+            module,
+            std::move(*library),
+            llvm::Linker::LinkOnlyNeeded,
+            [](llvm::Module &module, const llvm::StringSet<> &linked) {
+                llvm::internalizeModule(module, [&](const llvm::GlobalValue &GV) {
+                    return !linked.contains(GV.getName());
+                });
+            }
+    )) {
+        throw std::logic_error("failed to link runtime library bitcode");
+    }
 }
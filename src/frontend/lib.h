@@ -1,6 +1,14 @@
 #ifndef SYSY_COMPILER_FRONTEND_LIB_H
 #define SYSY_COMPILER_FRONTEND_LIB_H
 
+#include <llvm/IR/Function.h>
+
 void addLibraryPrototype();
 
+// 链接运行时库输入输出函数的bitcode（内部链接），使优化器可以内联、特化库函数
+void linkLibraryBitcode();
+
+// 按照目标平台的调用约定，为32位整数参数/返回值添加符号扩展属性
+void fixIntegerExtension(llvm::Function *func);
+
 #endif //SYSY_COMPILER_FRONTEND_LIB_H
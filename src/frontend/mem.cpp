@@ -1,18 +1,22 @@
 #include <vector>
 #include <functional>
+#include "IR.h"
+#include "mem.h"
 
 namespace Memory {
 
-    namespace Detail {
-        std::vector<std::function<void()>> destructors;
-    }
-
-    using namespace Detail;
-
-    void freeAll() {
+    void Arena::freeAll() {
         for (const auto &destructor: destructors) {
             destructor();
         }
         destructors.clear();
     }
-}
\ No newline at end of file
+
+    Arena &Detail::currentArena() {
+        return IR::ctx->arena;
+    }
+
+    void freeAll() {
+        Detail::currentArena().freeAll();
+    }
+}
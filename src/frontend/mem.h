@@ -3,24 +3,48 @@
 
 #include <vector>
 #include <functional>
+#include <utility>
 
 namespace Memory {
 
+    // 记录通过make创建的对象，在整个AST不再使用时统一释放
+    // 每个编译任务的Context拥有一个Arena，析构时自动释放其中剩余的对象
+    // 假设同一个Arena不会被并发访问，因此不使用同步机制
+    class Arena {
+        std::vector<std::function<void()>> destructors;
+    public:
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena() {
+            freeAll();
+        }
+
+        template<typename Ty, typename... Args>
+        Ty *make(Args &&... args) {
+            Ty *ptr = new Ty(std::forward<Args>(args)...);
+            destructors.emplace_back([ptr] { delete ptr; });
+            return ptr;
+        }
+
+        void freeAll();
+    };
+
     namespace Detail {
-        // 存储在mem.cpp中
-        // 假设该结构不会被并发访问，因此不使用同步机制
-        extern std::vector<std::function<void()>> destructors;
+        // 当前线程正在编译的源文件（IR::ctx）的Arena，定义在mem.cpp中
+        Arena &currentArena();
     }
 
     // 在创建AST节点时，使用该函数，通过完美转发，将参数传递给构造函数
     template<typename Ty, typename... Args>
     Ty *make(Args &&... args) {
-        Ty *ptr = new Ty(std::forward<Args>(args)...);
-        Detail::destructors.emplace_back([ptr] { delete ptr; });
-        return ptr;
+        return Detail::currentArena().make<Ty>(std::forward<Args>(args)...);
     }
 
-    // 在整个AST不再使用时，调用该函数，释放AST占用的内存
+    // 在整个AST不再使用时，调用该函数，释放当前编译任务的AST占用的内存
     void freeAll();
 }
 
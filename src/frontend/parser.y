@@ -3,14 +3,6 @@
 #include <string>
 #include <stdexcept>
 #include "log.h"
-#include "lexer.h"
-int yylex();
-extern int yyparse();
-void yyerror(const char* s);
-
-// 在词法分析器中定义的全局变量
-extern size_t currRow;
-extern size_t currCol;
 %}
 
 %code requires {
@@ -18,6 +10,12 @@ extern size_t currCol;
 #include "mem.h"
 #include "AST.h"
 #include "position.h"
+#include "lexer.h"
+}
+
+%code provides {
+int yylex(YYSTYPE *yylvalp, Lexer &lexer);
+void yyerror(Lexer &lexer, AST::Base *&root, const char *s);
 }
 
 // 在变量声明和函数声明，由于前序均为 TYPENAME IDENTIFIER
@@ -33,6 +31,12 @@ extern size_t currCol;
 %glr-parser
 %expect-rr 2
 
+// 可重入的语法分析器：不使用全局的yylval等变量，词法分析器与AST根节点通过参数传递
+// 不同线程可以同时分析不同的源文件
+%define api.pure
+%lex-param {Lexer &lexer}
+%parse-param {Lexer &lexer} {AST::Base *&root}
+
 %union {
     AST::Base *baseType;
     AST::Stmt *stmtType;
@@ -143,10 +147,10 @@ extern size_t currCol;
 
 compile_unit_opt
     : compile_unit {
-	AST::root = $1;
+	root = $1;
     }
     | /* empty */ {
-    	AST::root = Memory::make<AST::CompileUnit>();
+    	root = Memory::make<AST::CompileUnit>();
     }
     ;
 
@@ -727,6 +731,6 @@ const_expr
 
 %%
 
-void yyerror(const char* s) {
+void yyerror(Lexer &lexer, AST::Base *&root, const char *s) {
     throw std::runtime_error(s);
 }
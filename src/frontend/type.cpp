@@ -38,26 +38,26 @@ llvm::Value *TypeSystem::cast(llvm::Value *value, Typename wantType) {
 
     // bool -> int
     if (currType == Typename::BOOL && wantType == Typename::INT) {
-        return IR::ctx.builder.CreateZExt(
+        return IR::ctx->builder.CreateZExt(
                 value,
-                llvm::Type::getInt32Ty(IR::ctx.llvmCtx)
+                llvm::Type::getInt32Ty(IR::ctx->llvmCtx)
         );
     }
 
     // bool -> float
     if (currType == Typename::BOOL && wantType == Typename::FLOAT) {
-        return IR::ctx.builder.CreateUIToFP(
+        return IR::ctx->builder.CreateUIToFP(
                 value,
-                llvm::Type::getFloatTy(IR::ctx.llvmCtx)
+                llvm::Type::getFloatTy(IR::ctx->llvmCtx)
         );
     }
 
     // int -> bool
     if (currType == Typename::INT && wantType == Typename::BOOL) {
-        return IR::ctx.builder.CreateICmpNE(
+        return IR::ctx->builder.CreateICmpNE(
                 value,
                 llvm::ConstantInt::get(
-                        llvm::Type::getInt32Ty(IR::ctx.llvmCtx),
+                        llvm::Type::getInt32Ty(IR::ctx->llvmCtx),
                         0
                 )
         );
@@ -65,18 +65,18 @@ llvm::Value *TypeSystem::cast(llvm::Value *value, Typename wantType) {
 
     // int -> float
     if (currType == Typename::INT && wantType == Typename::FLOAT) {
-        return IR::ctx.builder.CreateSIToFP(
+        return IR::ctx->builder.CreateSIToFP(
                 value,
-                llvm::Type::getFloatTy(IR::ctx.llvmCtx)
+                llvm::Type::getFloatTy(IR::ctx->llvmCtx)
         );
     }
 
     // float -> bool
     if (currType == Typename::FLOAT && wantType == Typename::BOOL) {
-        return IR::ctx.builder.CreateFCmpONE(
+        return IR::ctx->builder.CreateFCmpONE(
                 value,
                 llvm::ConstantFP::get(
-                        llvm::Type::getFloatTy(IR::ctx.llvmCtx),
+                        llvm::Type::getFloatTy(IR::ctx->llvmCtx),
                         0.0
                 )
         );
@@ -84,9 +84,9 @@ llvm::Value *TypeSystem::cast(llvm::Value *value, Typename wantType) {
 
     // float -> int
     if (currType == Typename::FLOAT && wantType == Typename::INT) {
-        return IR::ctx.builder.CreateFPToSI(
+        return IR::ctx->builder.CreateFPToSI(
                 value,
-                llvm::Type::getInt32Ty(IR::ctx.llvmCtx)
+                llvm::Type::getInt32Ty(IR::ctx->llvmCtx)
         );
     }
 
@@ -96,13 +96,13 @@ llvm::Value *TypeSystem::cast(llvm::Value *value, Typename wantType) {
 llvm::Type *TypeSystem::get(Typename type) {
     switch (type) {
         case Typename::VOID:
-            return llvm::Type::getVoidTy(IR::ctx.llvmCtx);
+            return llvm::Type::getVoidTy(IR::ctx->llvmCtx);
         case Typename::BOOL:
-            return llvm::Type::getInt1Ty(IR::ctx.llvmCtx);
+            return llvm::Type::getInt1Ty(IR::ctx->llvmCtx);
         case Typename::INT:
-            return llvm::Type::getInt32Ty(IR::ctx.llvmCtx);
+            return llvm::Type::getInt32Ty(IR::ctx->llvmCtx);
         case Typename::FLOAT:
-            return llvm::Type::getFloatTy(IR::ctx.llvmCtx);
+            return llvm::Type::getFloatTy(IR::ctx->llvmCtx);
     }
     throw std::runtime_error("unknown type");
 }
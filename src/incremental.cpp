@@ -0,0 +1,332 @@
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#include "magic_enum.h"
+#include "IR.h"
+#include "log.h"
+#include "cache.h"
+#include "pass_manager.h"
+#include "incremental.h"
+
+static std::string printJSON(const llvm::json::Value &value) {
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    os << value;
+    return os.str();
+}
+
+// 收集AST中出现的所有名字（函数调用、变量引用、局部定义等）
+// 局部变量可能与全局符号同名，此时会多收集一个依赖，只会使缓存更保守
+static void collectNames(const llvm::json::Value &value, std::set<std::string> &names) {
+    if (auto *obj = value.getAsObject()) {
+        if (auto name = obj->getString("name")) {
+            names.insert(name->str());
+        }
+        for (auto &[key, child]: *obj) {
+            collectNames(child, names);
+        }
+    } else if (auto *array = value.getAsArray()) {
+        for (auto &child: *array) {
+            collectNames(child, names);
+        }
+    }
+}
+
+bool IncrementalCache::enabled(const Options &options) {
+    return options.incremental && !options.cacheDir.empty() && options.optLevel != 0 &&
+           !options.irInput && !options.emitPreOpt;
+}
+
+IncrementalCache::FunctionKeys IncrementalCache::computeKeys(AST::Base *root, const std::string &configuration) {
+    auto *unit = dynamic_cast<AST::CompileUnit *>(root);
+    if (!unit) {
+        throw std::logic_error("AST root is not a compile unit");
+    }
+
+    // 顶层符号（函数、全局变量、全局常量）的AST文本及其引用的名字
+    struct Symbol {
+        std::string text;
+        std::set<std::string> names;
+    };
+    std::map<std::string, Symbol> symbols;
+    std::vector<std::string> functions;
+
+    auto addSymbol = [&](const std::string &name, const std::string &prefix, const llvm::json::Value &json) {
+        Symbol &symbol = symbols[name];
+        symbol.text = prefix + printJSON(json);
+        collectNames(json, symbol.names);
+    };
+
+    for (AST::Base *element: unit->compileElements) {
+        if (auto *func = dynamic_cast<AST::FunctionDef *>(element)) {
+            addSymbol(func->name, "function ", func->toJSON());
+            functions.emplace_back(func->name);
+        } else if (auto *decl = dynamic_cast<AST::ConstVariableDecl *>(element)) {
+            for (AST::ConstVariableDef *def: decl->constVariableDefs) {
+                addSymbol(def->name, "const " + std::string(magic_enum::enum_name(decl->type)) + " ", def->toJSON());
+            }
+        } else if (auto *decl = dynamic_cast<AST::VariableDecl *>(element)) {
+            for (AST::VariableDef *def: decl->variableDefs) {
+                addSymbol(def->name, "var " + std::string(magic_enum::enum_name(decl->type)) + " ", def->toJSON());
+            }
+        }
+    }
+
+    FunctionKeys keys;
+    for (const std::string &function: functions) {
+        // 求出传递依赖的所有顶层符号
+        std::set<std::string> closure{function};
+        std::vector<std::string> worklist{function};
+        while (!worklist.empty()) {
+            std::string name = worklist.back();
+            worklist.pop_back();
+            for (const std::string &dep: symbols[name].names) {
+                if (symbols.count(dep) && closure.insert(dep).second) {
+                    worklist.emplace_back(dep);
+                }
+            }
+        }
+
+        llvm::SHA1 hasher;
+        hasher.update(configuration);
+        hasher.update("\nfunction " + function + "\n");
+        for (const std::string &name: closure) {
+            const std::string &text = symbols[name].text;
+            hasher.update(name + " " + std::to_string(text.size()) + " ");
+            hasher.update(text);
+        }
+        keys[function] = llvm::toHex(hasher.final(), true);
+    }
+    return keys;
+}
+
+// 收集常量中引用的全局符号，内部符号的初值中引用的符号也一并收集
+static void collectGlobals(
+        llvm::Constant *constant,
+        llvm::SetVector<llvm::GlobalValue *> &globals,
+        llvm::SmallPtrSetImpl<llvm::Constant *> &visited
+) {
+    if (!visited.insert(constant).second) {
+        return;
+    }
+    if (auto *GV = llvm::dyn_cast<llvm::GlobalValue>(constant)) {
+        globals.insert(GV);
+        auto *var = llvm::dyn_cast<llvm::GlobalVariable>(GV);
+        if (var && var->hasLocalLinkage() && var->hasInitializer()) {
+            collectGlobals(var->getInitializer(), globals, visited);
+        }
+        return;
+    }
+    for (llvm::Value *operand: constant->operands()) {
+        collectGlobals(llvm::cast<llvm::Constant>(operand), globals, visited);
+    }
+}
+
+// 提取一个已优化的函数，生成只包含该函数定义的模块，其引用的外部符号均为声明
+// 优化中产生的内部符号（如合并后的常量）随函数一起保存
+// 只复制函数引用到的符号，开销与函数大小成正比，而不是整个模块
+static std::unique_ptr<llvm::Module> extractFunction(llvm::Module &module, llvm::Function *function) {
+    llvm::SetVector<llvm::GlobalValue *> globals;
+    llvm::SmallPtrSet<llvm::Constant *, 32> visited;
+    for (llvm::Instruction &I: llvm::instructions(function)) {
+        for (llvm::Value *operand: I.operands()) {
+            if (auto *constant = llvm::dyn_cast<llvm::Constant>(operand)) {
+                collectGlobals(constant, globals, visited);
+            }
+        }
+    }
+
+    auto piece = std::make_unique<llvm::Module>(function->getName(), module.getContext());
+    piece->setTargetTriple(module.getTargetTriple());
+    piece->setDataLayout(module.getDataLayout());
+
+    llvm::ValueToValueMapTy VMap;
+    auto *newFunction = llvm::Function::Create(
+            function->getFunctionType(),
+            function->getLinkage(),
+            function->getName(),
+            *piece
+    );
+    newFunction->copyAttributesFrom(function);
+    VMap[function] = newFunction;
+
+    std::vector<llvm::GlobalVariable *> localVariables;
+    for (llvm::GlobalValue *GV: globals) {
+        if (GV == function) {
+            continue;
+        }
+        if (auto *F = llvm::dyn_cast<llvm::Function>(GV)) {
+            if (F->hasLocalLinkage()) {
+                throw std::logic_error("unexpected internal function: " + F->getName().str());
+            }
+            auto *decl = llvm::Function::Create(
+                    F->getFunctionType(),
+                    llvm::GlobalValue::ExternalLinkage,
+                    F->getName(),
+                    *piece
+            );
+            decl->copyAttributesFrom(F);
+            VMap[F] = decl;
+        } else if (auto *var = llvm::dyn_cast<llvm::GlobalVariable>(GV)) {
+            auto *copy = new llvm::GlobalVariable(
+                    *piece,
+                    var->getValueType(),
+                    var->isConstant(),
+                    var->hasLocalLinkage() ? var->getLinkage() : llvm::GlobalValue::ExternalLinkage,
+                    nullptr,
+                    var->getName()
+            );
+            copy->copyAttributesFrom(var);
+            VMap[var] = copy;
+            if (var->hasLocalLinkage()) {
+                localVariables.emplace_back(var);
+            }
+        } else {
+            throw std::logic_error("unexpected global value: " + GV->getName().str());
+        }
+    }
+
+    // 所有符号都建立映射后，再复制内部变量的初值与函数体
+    for (llvm::GlobalVariable *var: localVariables) {
+        llvm::cast<llvm::GlobalVariable>(VMap[var])->setInitializer(
+                llvm::MapValue(var->getInitializer(), VMap)
+        );
+    }
+    auto newArg = newFunction->arg_begin();
+    for (llvm::Argument &arg: function->args()) {
+        newArg->setName(arg.getName());
+        VMap[&arg] = &*newArg++;
+    }
+    llvm::SmallVector<llvm::ReturnInst *, 8> returns;
+    llvm::CloneFunctionInto(newFunction, function, VMap, llvm::CloneFunctionChangeType::DifferentModule, returns);
+
+    // 跨模块复制时会创建空的llvm.dbg.cu，读取时会被当作版本无效的调试信息而产生警告
+    if (llvm::NamedMDNode *debugCU = piece->getNamedMetadata("llvm.dbg.cu")) {
+        if (debugCU->getNumOperands() == 0) {
+            piece->eraseNamedMetadata(debugCU);
+        }
+    }
+
+    return piece;
+}
+
+static void linkModule(llvm::Module &module, std::unique_ptr<llvm::Module> piece) {
+    if (llvm::Linker::linkModules(module, std::move(piece))) {
+        throw std::logic_error("failed to link cached function");
+    }
+}
+
+void IncrementalCache::optimize(
+        const Options &options,
+        llvm::TargetMachine *targetMachine,
+        const FunctionKeys &keys
+) {
+    llvm::Module &module = IR::ctx->module;
+
+    // 记录函数顺序，链接后恢复，使函数在输出中的顺序与缓存状态无关
+    // 函数体则与缓存状态有关：重新优化时已缓存的被调函数只有声明，不会被内联，
+    // 同一个键下缓存的函数体取决于写入时哪些被调函数未命中（都是正确的，只是内联的多少不同）
+    std::vector<std::string> order;
+    for (llvm::Function &F: module) {
+        if (!F.isDeclaration()) {
+            order.emplace_back(F.getName().str());
+        }
+    }
+
+    // 外部化内部链接的符号，使各函数可以单独缓存、链接
+    std::map<std::string, llvm::GlobalValue::LinkageTypes> saved;
+    for (llvm::GlobalValue &GV: module.global_values()) {
+        if (GV.hasLocalLinkage()) {
+            saved[GV.getName().str()] = GV.getLinkage();
+            GV.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            GV.setVisibility(llvm::GlobalValue::HiddenVisibility);
+        }
+    }
+
+    // 读取缓存，无法解析的条目视为未命中
+    std::map<std::string, std::unique_ptr<llvm::Module>> cached;
+    std::vector<std::string> dirty;
+    for (const std::string &name: order) {
+        auto key = keys.find(name);
+        if (key == keys.end()) {
+            throw std::logic_error("no cache key for function " + name);
+        }
+        if (auto buffer = CompileCache::load(options, key->second)) {
+            auto piece = llvm::parseBitcodeFile(buffer->getMemBufferRef(), module.getContext());
+            if (piece) {
+                cached[name] = std::move(*piece);
+                continue;
+            }
+            llvm::consumeError(piece.takeError());
+        }
+        dirty.emplace_back(name);
+    }
+    log("incremental") << cached.size() << " cached, " << dirty.size() << " dirty functions" << std::endl;
+
+    // 已缓存函数不再需要前端生成的函数体，优化管道中只保留其声明
+    for (auto &[name, piece]: cached) {
+        module.getFunction(name)->deleteBody();
+    }
+
+    if (!dirty.empty()) {
+        // 链接的运行时库函数、记忆化生成的缓存表与f.uncached、并行化提取的f.parallel都是内部符号，无法与单个函数一起缓存
+        Options pipelineOptions = options;
+        pipelineOptions.runtimeBitcode = false;
+        pipelineOptions.memoize = false;
+        pipelineOptions.parallel = false;
+        PassManager::optimize(pipelineOptions, targetMachine);
+
+        // 将新优化的函数写入缓存
+        for (const std::string &name: dirty) {
+            llvm::Function *F = module.getFunction(name);
+            if (!F || F->isDeclaration()) {
+                throw std::logic_error("optimized function not found: " + name);
+            }
+            llvm::SmallString<0> buffer;
+            llvm::raw_svector_ostream os(buffer);
+            llvm::WriteBitcodeToFile(*extractFunction(module, F), os);
+            CompileCache::save(options, keys.at(name), buffer);
+        }
+    }
+
+    // 链接缓存中的函数
+    for (auto &[name, piece]: cached) {
+        linkModule(module, std::move(piece));
+    }
+
+    // 恢复函数顺序与链接属性
+    for (const std::string &name: order) {
+        if (llvm::Function *F = module.getFunction(name)) {
+            module.getFunctionList().splice(module.end(), module.getFunctionList(), F->getIterator());
+        }
+    }
+    for (auto &[name, linkage]: saved) {
+        llvm::GlobalValue *GV = module.getNamedValue(name);
+        if (GV && !GV->isDeclaration()) {
+            GV->setLinkage(linkage);
+            GV->setVisibility(llvm::GlobalValue::DefaultVisibility);
+        }
+    }
+
+    CompileCache::addStats(options, {
+            {"function-hits",   cached.size()},
+            {"function-misses", dirty.size()},
+    });
+    CompileCache::prune(options);
+
+    IR::show();
+}
@@ -0,0 +1,33 @@
+#ifndef SYSY_COMPILER_INCREMENTAL_H
+#define SYSY_COMPILER_INCREMENTAL_H
+
+#include <map>
+#include <string>
+#include <llvm/Target/TargetMachine.h>
+#include "AST.h"
+#include "options.h"
+
+// 函数级增量编译缓存（--incremental）
+// 以函数为单位缓存优化后的IR（bitcode），只对发生变化的函数运行优化管道：
+// 1. 每个函数的缓存键由其AST的结构（不含源码位置）、传递调用的所有函数以及引用的全局变量/常量的AST计算
+//    被调用函数的变化会使调用者失效，因此内联的结果总是有效的
+// 2. 所有内部链接的符号临时外部化，使优化器不依赖模块中其他函数的信息（如IPSCCP、全局变量的常量化）
+// 3. 只对未命中的函数运行优化管道，已缓存的函数只保留声明（不会被内联到未命中的函数中）
+// 4. 将新优化的函数写入缓存，链接缓存中的函数，恢复原本的函数顺序与链接属性，再统一生成代码
+// 因此增量编译的结果与缓存状态有关（内联机会可能少于完整编译），但总是正确的
+namespace IncrementalCache {
+    // 函数名 -> 缓存键
+    using FunctionKeys = std::map<std::string, std::string>;
+
+    // 是否对本次编译启用增量缓存，-O0或输出优化前的IR时不运行优化管道，无需缓存
+    // 输入为LLVM IR时没有AST，无法计算函数的缓存键
+    bool enabled(const Options &options);
+
+    // 根据AST计算各函数的缓存键，需要在常量求值之前调用（常量求值会改写AST）
+    FunctionKeys computeKeys(AST::Base *root, const std::string &configuration);
+
+    // 代替PassManager::optimize，复用缓存中已优化的函数
+    void optimize(const Options &options, llvm::TargetMachine *targetMachine, const FunctionKeys &keys);
+}
+
+#endif //SYSY_COMPILER_INCREMENTAL_H
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <stdexcept>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Support/raw_ostream.h>
+#include "log.h"
+#include "target.h"
+#include "jit.h"
+
+// 宿主机版本的SysY运行时库（runtime_lib/sylib.c），随编译器一起链接
+// 不能直接包含sylib.h，因为它在头文件中定义了全局变量
+extern "C" {
+int getint();
+int getch();
+int getarray(int a[]);
+float getfloat();
+int getfarray(float a[]);
+void putint(int a);
+void putch(int a);
+void putarray(int n, int a[]);
+void putfloat(float a);
+void putfarray(int n, float a[]);
+void _sysy_starttime(int lineno);
+void _sysy_stoptime(int lineno);
+void _sysy_parallel_for(int begin, int end, void (*body)(int, int, int, void *), void *ctx);
+void _sysy_matmul_i32(int m, int n, int k, int *c, int ci, int cj,
+                      const int *a, int ai, int ak, const int *b, int bk, int bj, int accumulate);
+void _sysy_matmul_f32(int m, int n, int k, float *c, int ci, int cj,
+                      const float *a, int ai, int ak, const float *b, int bk, int bj, int accumulate);
+void _sysy_conv2d_i32(int m, int n, int p, int q, int *o, int oi, int oj,
+                      const int *x, int xi, int xj, int xp, int xq, const int *w, int wp, int wq, int accumulate);
+void _sysy_conv2d_f32(int m, int n, int p, int q, float *o, int oi, int oj,
+                      const float *x, int xi, int xj, int xp, int xq, const float *w, int wp, int wq, int accumulate);
+void before_main();
+void after_main();
+}
+
+// 将llvm::Expected中的错误转换为异常
+template<typename Ty>
+static Ty unwrap(llvm::Expected<Ty> value) {
+    if (!value) {
+        throw std::logic_error(llvm::toString(value.takeError()));
+    }
+    return std::move(*value);
+}
+
+static void unwrap(llvm::Error error) {
+    if (error) {
+        throw std::logic_error(llvm::toString(std::move(error)));
+    }
+}
+
+// LLJIT需要独占模块及其LLVMContext，而IR::ctx中的模块不可转移，因此通过bitcode复制一份
+static llvm::orc::ThreadSafeModule cloneToThreadSafeModule(llvm::Module &module) {
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream os(buffer);
+    llvm::WriteBitcodeToFile(module, os);
+
+    auto llvmCtx = std::make_unique<llvm::LLVMContext>();
+    auto clone = unwrap(llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(llvm::StringRef(buffer.data(), buffer.size()), "SysY_src"),
+            *llvmCtx
+    ));
+    return {std::move(clone), std::move(llvmCtx)};
+}
+
+int JIT::run(llvm::Module &module) {
+    Target::initialize();
+
+    auto jit = unwrap(llvm::orc::LLJITBuilder().create());
+    auto &mainJD = jit->getMainJITDylib();
+
+    // 绑定SysY运行时库函数
+    llvm::orc::SymbolMap runtimeSymbols;
+    auto bind = [&](const char *name, auto *func) {
+        runtimeSymbols[jit->mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(
+                llvm::pointerToJITTargetAddress(func),
+                llvm::JITSymbolFlags::Exported
+        );
+    };
+    bind("getint", &getint);
+    bind("getch", &getch);
+    bind("getarray", &getarray);
+    bind("getfloat", &getfloat);
+    bind("getfarray", &getfarray);
+    bind("putint", &putint);
+    bind("putch", &putch);
+    bind("putarray", &putarray);
+    bind("putfloat", &putfloat);
+    bind("putfarray", &putfarray);
+    bind("_sysy_starttime", &_sysy_starttime);
+    bind("_sysy_stoptime", &_sysy_stoptime);
+    bind("_sysy_parallel_for", &_sysy_parallel_for);
+    bind("_sysy_matmul_i32", &_sysy_matmul_i32);
+    bind("_sysy_matmul_f32", &_sysy_matmul_f32);
+    bind("_sysy_conv2d_i32", &_sysy_conv2d_i32);
+    bind("_sysy_conv2d_f32", &_sysy_conv2d_f32);
+    unwrap(mainJD.define(llvm::orc::absoluteSymbols(std::move(runtimeSymbols))));
+
+    // 后端可能生成memset/memcpy等libc调用，从编译器进程中查找
+    mainJD.addGenerator(unwrap(
+            llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                    jit->getDataLayout().getGlobalPrefix()
+            )
+    ));
+
+    unwrap(jit->addIRModule(cloneToThreadSafeModule(module)));
+
+    log("JIT") << "compile main" << std::endl;
+    auto mainSymbol = unwrap(jit->lookup("main"));
+    auto mainFunc = llvm::jitTargetAddressToFunction<int (*)()>(mainSymbol.getAddress());
+
+    log("JIT") << "run main" << std::endl;
+    before_main();
+    int ret = mainFunc();
+    after_main();
+    fflush(stdout);
+
+    return ret;
+}
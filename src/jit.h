@@ -0,0 +1,13 @@
+#ifndef SYSY_COMPILER_JIT_H
+#define SYSY_COMPILER_JIT_H
+
+#include <llvm/IR/Module.h>
+
+namespace JIT {
+    // 使用ORC LLJIT在宿主机上编译并执行模块中的main函数
+    // SysY运行时库函数绑定到编译器内置的宿主机版本sylib.c，标准输入输出直接透传
+    // 返回值为main函数的返回值
+    int run(llvm::Module &module);
+}
+
+#endif //SYSY_COMPILER_JIT_H
@@ -0,0 +1,119 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include "log.h"
+#include "linker.h"
+
+// 根据目标平台，给出可能的链接器（gcc/clang驱动程序）
+// 交叉编译工具链优先，其次是能够指定目标的clang
+static std::vector<std::string> linkerCandidates(const llvm::Triple &triple) {
+    std::vector<std::string> candidates;
+
+    // 目标平台与宿主机相同时，直接使用本机的编译器驱动
+    llvm::Triple host(llvm::sys::getProcessTriple());
+    if (host.getArch() == triple.getArch() && host.getOS() == triple.getOS()) {
+        candidates.emplace_back("cc");
+        candidates.emplace_back("gcc");
+    }
+
+    if (triple.getArch() == llvm::Triple::arm) {
+#ifdef CONF_HARD_FLOAT
+        candidates.emplace_back("arm-linux-gnueabihf-gcc");
+#else
+        candidates.emplace_back("arm-linux-gnueabi-gcc");
+#endif
+    }
+
+    candidates.emplace_back("clang");
+    return candidates;
+}
+
+// 运行时库：arm平台使用预编译的静态库，其他平台直接交给驱动程序编译sylib.c
+static std::string runtimeLibrary(const llvm::Triple &triple) {
+    if (triple.getArch() == llvm::Triple::arm) {
+        return CONF_RUNTIME_LIB_DIR "/libsysy.a";
+    }
+    return CONF_RUNTIME_LIB_DIR "/sylib.c";
+}
+
+// 查找链接器，优先使用用户指定的链接器
+static std::string findLinker(const llvm::Triple &triple, const std::string &linker) {
+    if (!linker.empty()) {
+        auto path = llvm::sys::findProgramByName(linker);
+        if (!path) {
+            throw std::runtime_error("linker not found: " + linker);
+        }
+        return *path;
+    }
+
+    for (const std::string &candidate: linkerCandidates(triple)) {
+        if (auto path = llvm::sys::findProgramByName(candidate)) {
+            return *path;
+        }
+    }
+    throw std::runtime_error(
+            "no linker found for target " + triple.str() + ", use --linker=<driver>"
+    );
+}
+
+// 调用链接器，extraArgs放在目标文件之前
+static void invokeLinker(
+        const std::vector<std::string> &extraArgs,
+        const std::vector<std::string> &inputFilenames,
+        const std::string &outputFilename,
+        const llvm::Triple &triple,
+        const std::string &linker
+) {
+    std::string linkerPath = findLinker(triple, linker);
+
+    // 组装命令行
+    std::vector<std::string> args{linkerPath};
+    if (llvm::sys::path::filename(linkerPath).startswith("clang")) {
+        args.emplace_back("--target=" + triple.str());
+    }
+    args.insert(args.end(), extraArgs.begin(), extraArgs.end());
+    args.insert(args.end(), inputFilenames.begin(), inputFilenames.end());
+    args.emplace_back("-o");
+    args.emplace_back(outputFilename);
+
+    std::vector<llvm::StringRef> argRefs(args.begin(), args.end());
+
+    log("linker") << "invoke " << linkerPath << std::endl;
+
+    std::string errMsg;
+    int ret = llvm::sys::ExecuteAndWait(linkerPath, argRefs, llvm::None, {}, 0, 0, &errMsg);
+    if (ret != 0) {
+        throw std::runtime_error(
+                "linker failed with exit code " + std::to_string(ret) +
+                (errMsg.empty() ? "" : ": " + errMsg)
+        );
+    }
+}
+
+void Linker::link(
+        const std::vector<std::string> &objectFilenames,
+        const std::string &outputFilename,
+        const std::string &triple,
+        const std::string &linker
+) {
+    llvm::Triple targetTriple(triple);
+    std::vector<std::string> inputFilenames = objectFilenames;
+    inputFilenames.emplace_back(runtimeLibrary(targetTriple));
+    // 并行循环的运行时（_sysy_parallel_for）使用pthread
+    inputFilenames.emplace_back("-lpthread");
+    invokeLinker({}, inputFilenames, outputFilename, targetTriple, linker);
+}
+
+void Linker::linkRelocatable(
+        const std::vector<std::string> &objectFilenames,
+        const std::string &outputFilename,
+        const std::string &triple,
+        const std::string &linker
+) {
+    invokeLinker({"-r", "-nostdlib"}, objectFilenames, outputFilename, llvm::Triple(triple), linker);
+}
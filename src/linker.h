@@ -0,0 +1,25 @@
+#ifndef SYSY_COMPILER_LINKER_H
+#define SYSY_COMPILER_LINKER_H
+
+#include <string>
+#include <vector>
+
+namespace Linker {
+    // 调用外部链接器，将目标文件与SysY运行时库链接为可执行文件
+    void link(
+            const std::vector<std::string> &objectFilenames,
+            const std::string &outputFilename,
+            const std::string &triple,
+            const std::string &linker
+    );
+
+    // 调用外部链接器进行可重定位链接（-r），将多个目标文件合并为一个
+    void linkRelocatable(
+            const std::vector<std::string> &objectFilenames,
+            const std::string &outputFilename,
+            const std::string &triple,
+            const std::string &linker
+    );
+}
+
+#endif //SYSY_COMPILER_LINKER_H
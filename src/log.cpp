@@ -23,7 +23,8 @@ std::ostream &log(std::string_view module) {
 #ifdef CONF_LOG_OUTPUT
     return log_(std::cout, module, false);
 #else
-    static DummyLogStream dummy;
+    // 每个线程使用各自的流，多个编译任务并行时不会同时修改流的状态
+    static thread_local DummyLogStream dummy;
     return dummy;
 #endif
 }
@@ -36,6 +37,8 @@ llvm::raw_ostream &log_llvm() {
 #ifdef CONF_LOG_OUTPUT
     return llvm::outs();
 #else
-    return llvm::nulls();
+    // Module::print会修改输出流的缓冲模式，每个线程使用各自的流
+    static thread_local llvm::raw_null_ostream dummy;
+    return dummy;
 #endif
 }
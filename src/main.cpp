@@ -1,73 +1,132 @@
 #include <iostream>
-#include <tuple>
 #include <string>
-#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include "AST.h"
 #include "log.h"
-#include "parser.h"
-#include "mem.h"
 #include "IR.h"
+#include "compiler.h"
 #include "pass_manager.h"
-#include "scope.h"
+#include "options.h"
+#include "target.h"
+#include "jit.h"
+#include "cache.h"
+#include "incremental.h"
+#include "lib.h"
+#include "server.h"
+#include "batch.h"
 
-// 命令行格式：
-// compiler -S -o testcase.s testcase.sy
-// compiler -S -o testcase.s testcase.sy -O2
-// [0]      [1][2][3]        [4]         [5]
+// 编译一个源文件，出错时抛出异常，返回退出码（--run模式下为程序的返回值）
+// 使用独立的IR上下文、词法分析器与AST内存，可以在多个线程中同时调用
+static int compileFile(const Options &options) {
+    // 本次编译的IR上下文（包括AST的内存），在所有引用它的对象之后析构
+    Context context;
+    IR::ContextScope contextScope(context);
 
-static std::tuple<std::string, std::string, int>
-cmdParse(int argc, char *argv[]) {
-    if (argc != 5 && argc != 6) {
-        throw std::runtime_error("invalid command params");
+    // 创建目标机器，在生成IR前确定triple和data layout
+    auto targetMachine = Target::createTargetMachine(options.target);
+    Target::configureModule(IR::ctx->module, *targetMachine);
+
+    // 读取源文件，不重定向stdin，以便--run模式下的程序使用标准输入
+    std::ifstream inputFile(options.inputFilename, std::ios::binary);
+    if (!inputFile) {
+        throw std::runtime_error("failed to open file: " + options.inputFilename);
     }
+    std::string source{std::istreambuf_iterator<char>(inputFile), {}};
 
-    // 获得优化级别
-    int optLevel = 0;
-    if (argc == 6 && std::string_view(argv[5]) == "-O2") {
-        optLevel = 2;
+    // 与源代码无关的缓存键部分，在生成IR前计算，此时模块中只有运行时库函数原型
+    std::string cacheConfiguration;
+    if (CompileCache::enabled(options) || IncrementalCache::enabled(options)) {
+        addLibraryPrototype();
+        cacheConfiguration = CompileCache::configurationKey(options, IR::ctx->module);
     }
-    return {argv[4], argv[3], optLevel};
-}
 
-int main(int argc, char *argv[]) {
-    log("main") << "SysY compiler" << std::endl;
+    // 查找编译缓存，命中时直接输出缓存的文件，跳过整个编译过程
+    std::string cacheKey;
+    if (CompileCache::enabled(options)) {
+        cacheKey = CompileCache::computeKey(options, cacheConfiguration, source);
+        if (CompileCache::fetch(options, cacheKey)) {
+            if (options.cacheStats) {
+                CompileCache::printStats(options);
+            }
+            return 0;
+        }
+    }
 
-    try {
-        // 在try块结束后自动释放内存
-        // 由于使用的是C++17，还没有scope_exit特性，所以用了个非标准的实现
-        nonstd::scope_exit cleanup([] {
-            log("main") << "clean up" << std::endl;
-            Memory::freeAll();
-        });
+    IncrementalCache::FunctionKeys functionKeys;
+    if (options.irInput) {
+        // 输入为LLVM IR/bitcode，跳过前端
+        Compiler::loadIR(llvm::MemoryBufferRef(source, options.inputFilename));
+    } else {
+        // 生成AST
+        AST::Base *root = Compiler::parse(std::move(source));
 
-        // 解析命令行参数
-        auto [inputFilename, outputFilename, optLevel] = cmdParse(argc, argv);
+        // 函数级缓存的键依赖于AST的原始结构，需要在常量求值前计算
+        if (IncrementalCache::enabled(options)) {
+            functionKeys = IncrementalCache::computeKeys(root, cacheConfiguration);
+        }
+
+        // 常量求值并生成IR
+        Compiler::generateIR(root);
+    }
+
+    // 优化，启用增量缓存时只重新优化发生变化的函数
+    if (IncrementalCache::enabled(options)) {
+        IncrementalCache::optimize(options, targetMachine.get(), functionKeys);
+    } else {
+        PassManager::optimize(options, targetMachine.get());
+    }
 
-        // 输入重定向
-        if (auto fd = freopen(inputFilename.c_str(), "r", stdin);
-                fd == nullptr) {
-            throw std::runtime_error("failed to open file: " + inputFilename);
+    // --run模式：直接在宿主机上执行，返回程序的返回值
+    if (options.run) {
+        if (options.cacheStats) {
+            CompileCache::printStats(options);
         }
+        return JIT::run(IR::ctx->module);
+    }
 
-        // 生成AST
-        yyparse();
+    // 生成汇编代码/目标文件/可执行文件
+    PassManager::emit(options, targetMachine.get());
 
-        log("main") << "AST root at: " << AST::root << std::endl;
+    if (!cacheKey.empty()) {
+        CompileCache::store(options, cacheKey);
+    }
+    if (options.cacheStats) {
+        CompileCache::printStats(options);
+    }
+    return 0;
+}
+
+// 处理一次命令行调用，--server模式下每个请求在fork出的子进程中调用
+static int compile(int argc, char *argv[]) {
+    log("main") << "SysY compiler" << std::endl;
+
+    try {
+        // 解析命令行参数
+        Options options = Options::parse(argc, argv);
 
-        // 常量求值，包括：常量初值、全局变量初值、数组维度
-        AST::root->constEval(AST::root);
+        // 修改LLVM的全局选项，在服务器处理请求、批量编译的线程启动之前
+        if (options.assumeInbounds) {
+            PassManager::assumeInboundsSubscripts();
+        }
 
-        // IR生成
-        AST::root->codeGen();
+        // 编译服务器模式，在此之前不做任何与请求相关的初始化
+        if (options.server) {
+            return Server::serve(options.serverSocket, compile);
+        }
 
-        // 在运行Pass前释放AST占用的内存，降低内存占用峰值
-        Memory::freeAll();
+        // 批量编译模式
+        if (!options.batchFilename.empty()) {
+            return Batch::run(options, compileFile);
+        }
 
-        // 展示原始IR
-        IR::show();
+        // 只查询缓存统计
+        if (options.inputFilename.empty()) {
+            CompileCache::printStats(options);
+            return 0;
+        }
 
-        // 生成汇编代码
-        PassManager::run(optLevel, outputFilename);
+        return compileFile(options);
 
     } catch (std::runtime_error &e) {
         err("main") << "invalid source file: " << e.what() << std::endl;
@@ -76,5 +135,8 @@ int main(int argc, char *argv[]) {
         err("main") << "internal error: " << e.what() << std::endl;
         return 2;
     }
-    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    return compile(argc, argv);
 }
@@ -0,0 +1,230 @@
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "target.h"
+#include "server_protocol.h"
+#include "options.h"
+
+// 命令行格式：
+// compiler -S -o testcase.s testcase.sy [-O2]
+// compiler -c -o testcase.o testcase.sy [-O2]
+// compiler -o testcase testcase.sy [-O2] [--linker=arm-linux-gnueabihf-gcc]
+// compiler -S -o testcase.s testcase.sy --target=x86_64-linux-gnu
+// compiler --run testcase.sy [-O2] < testcase.in
+// compiler -S -o testcase.s testcase.sy -O2 -j 8
+// compiler -S -o testcase.s testcase.sy -O2 --no-runtime-bitcode
+// compiler -S -o testcase.s testcase.sy -O2 --memoize
+// compiler -o testcase testcase.sy -O2 --parallel
+// compiler -S -o testcase.s testcase.sy -O2 --tile-size=64
+// compiler -S -o testcase.s testcase.sy -O2 --assume-inbounds
+// compiler -o testcase testcase.sy -O2 --kernels
+// compiler -emit-llvm[=pre-opt|post-opt] -o testcase.ll testcase.sy [-O2]
+// compiler -emit-bc[=pre-opt|post-opt] -o testcase.bc testcase.sy [-O2]
+// compiler -S -o testcase.s testcase.ll -O2
+// compiler -c -o testcase.o testcase.sy -O2 --cache-dir=.sysy_cache [--cache-size=1g]
+// compiler -S -o testcase.s testcase.sy -O2 --cache-dir=.sysy_cache --incremental
+// compiler --cache-stats --cache-dir=.sysy_cache
+// compiler --server[=/tmp/sysy_compiler.sock]
+// compiler -S --batch list.txt -O2 -j 8
+// 选项与输入文件的顺序不限
+
+// 解析带k/m/g后缀的大小，例：256m
+static uint64_t parseSize(const std::string &value) {
+    size_t pos = 0;
+    uint64_t size = 0;
+    try {
+        size = std::stoull(value, &pos);
+    } catch (std::exception &) {
+        throw std::runtime_error("invalid size: " + value);
+    }
+    std::string suffix = value.substr(pos);
+    if (suffix == "k" || suffix == "K") {
+        size <<= 10;
+    } else if (suffix == "m" || suffix == "M") {
+        size <<= 20;
+    } else if (suffix == "g" || suffix == "G") {
+        size <<= 30;
+    } else if (!suffix.empty()) {
+        throw std::runtime_error("invalid size: " + value);
+    }
+    return size;
+}
+
+// 解析-emit-llvm/-emit-bc的后缀，返回是否输出优化前的IR
+static bool parseEmitStage(std::string_view arg, std::string_view option) {
+    std::string_view stage = arg.substr(option.size());
+    if (stage.empty() || stage == "=post-opt") {
+        return false;
+    }
+    if (stage == "=pre-opt") {
+        return true;
+    }
+    throw std::runtime_error("unknown option: " + std::string(arg));
+}
+
+bool Options::isIRFilename(const std::string &filename) {
+    auto endsWith = [&](const std::string &suffix) {
+        return filename.size() >= suffix.size() &&
+               filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return endsWith(".ll") || endsWith(".bc");
+}
+
+Options Options::parse(int argc, char *argv[]) {
+    Options options;
+
+    // -emit-llvm/-emit-bc优先于-S/-c，与参数顺序无关
+    std::optional<OutputType> irOutputType;
+
+    if (const char *cacheDir = std::getenv("SYSY_CACHE_DIR")) {
+        options.cacheDir = cacheDir;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+
+        if (arg == "-S") {
+            options.outputType = OutputType::ASSEMBLY;
+        } else if (arg == "-c") {
+            options.outputType = OutputType::OBJECT;
+        } else if (arg == "-o") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("missing filename after '-o'");
+            }
+            options.outputFilename = argv[++i];
+        } else if (arg.size() == 3 && arg.substr(0, 2) == "-O" &&
+                   arg[2] >= '0' && arg[2] <= '3') {
+            options.optLevel = arg[2] - '0';
+        } else if (arg.substr(0, 2) == "-j") {
+            // 支持 -j 8 和 -j8 两种写法
+            std::string value(arg.substr(2));
+            if (value.empty()) {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error("missing number after '-j'");
+                }
+                value = argv[++i];
+            }
+            int jobs = 0;
+            try {
+                jobs = std::stoi(value);
+            } catch (std::exception &) {
+            }
+            if (jobs <= 0) {
+                throw std::runtime_error("invalid number of jobs: " + value);
+            }
+            options.jobs = jobs;
+        } else if (arg.substr(0, 10) == "-emit-llvm") {
+            irOutputType = OutputType::LLVM_ASSEMBLY;
+            options.emitPreOpt = parseEmitStage(arg, "-emit-llvm");
+        } else if (arg.substr(0, 8) == "-emit-bc") {
+            irOutputType = OutputType::LLVM_BITCODE;
+            options.emitPreOpt = parseEmitStage(arg, "-emit-bc");
+        } else if (arg == "--run") {
+            options.run = true;
+        } else if (arg.substr(0, 9) == "--target=") {
+            options.target = arg.substr(9);
+        } else if (arg.substr(0, 9) == "--linker=") {
+            options.linker = arg.substr(9);
+        } else if (arg.substr(0, 12) == "--cache-dir=") {
+            options.cacheDir = arg.substr(12);
+        } else if (arg.substr(0, 13) == "--cache-size=") {
+            options.cacheSize = parseSize(std::string(arg.substr(13)));
+        } else if (arg == "--no-runtime-bitcode") {
+            options.runtimeBitcode = false;
+        } else if (arg == "--memoize") {
+            options.memoize = true;
+        } else if (arg == "--parallel") {
+            options.parallel = true;
+        } else if (arg == "--kernels") {
+            options.kernels = true;
+        } else if (arg == "--assume-inbounds") {
+            options.assumeInbounds = true;
+        } else if (arg.substr(0, 12) == "--tile-size=") {
+            std::string value(arg.substr(12));
+            int tileSize = -1;
+            try {
+                tileSize = std::stoi(value);
+            } catch (std::exception &) {
+            }
+            if (tileSize < 0) {
+                throw std::runtime_error("invalid tile size: " + value);
+            }
+            options.tileSize = tileSize;
+        } else if (arg == "--incremental") {
+            options.incremental = true;
+        } else if (arg == "--cache-stats") {
+            options.cacheStats = true;
+        } else if (arg == "--batch") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("missing filename after '--batch'");
+            }
+            options.batchFilename = argv[++i];
+        } else if (arg.substr(0, 8) == "--batch=") {
+            options.batchFilename = arg.substr(8);
+        } else if (arg == "--server") {
+            options.server = true;
+            options.serverSocket = ServerProtocol::defaultSocketPath();
+        } else if (arg.substr(0, 9) == "--server=") {
+            options.server = true;
+            options.serverSocket = arg.substr(9);
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::runtime_error("unknown option: " + std::string(arg));
+        } else {
+            if (!options.inputFilename.empty()) {
+                throw std::runtime_error("multiple input files");
+            }
+            options.inputFilename = arg;
+        }
+    }
+
+    if (irOutputType) {
+        if (options.run) {
+            throw std::runtime_error("-emit-llvm/-emit-bc cannot be used with --run");
+        }
+        options.outputType = *irOutputType;
+    }
+    options.irInput = isIRFilename(options.inputFilename);
+
+    if (options.server) {
+        if (!options.inputFilename.empty()) {
+            throw std::runtime_error("--server does not take an input file");
+        }
+        return options;
+    }
+    if (options.cacheStats && options.cacheDir.empty()) {
+        throw std::runtime_error("--cache-stats requires --cache-dir");
+    }
+    if (options.incremental && options.cacheDir.empty()) {
+        throw std::runtime_error("--incremental requires --cache-dir");
+    }
+    if (!options.batchFilename.empty()) {
+        if (!options.inputFilename.empty() || !options.outputFilename.empty()) {
+            throw std::runtime_error("--batch takes input and output files from the list");
+        }
+        if (options.run) {
+            throw std::runtime_error("--batch cannot be used with --run");
+        }
+        options.target = Target::normalize(options.target);
+        return options;
+    }
+    if (options.inputFilename.empty()) {
+        if (options.cacheStats) {
+            return options;
+        }
+        throw std::runtime_error("no input file");
+    }
+    if (options.run) {
+        if (!options.target.empty() && options.target != "native") {
+            throw std::runtime_error("--run only supports the native target");
+        }
+        options.target = "native";
+    } else if (options.outputFilename.empty()) {
+        throw std::runtime_error("no output file");
+    }
+
+    options.target = Target::normalize(options.target);
+
+    return options;
+}
@@ -0,0 +1,91 @@
+#ifndef SYSY_COMPILER_OPTIONS_H
+#define SYSY_COMPILER_OPTIONS_H
+
+#include <cstdint>
+#include <string>
+
+// 输出文件类型
+enum class OutputType {
+    // -S：汇编文件
+    ASSEMBLY,
+    // -c：ELF目标文件，由LLVM直接生成，无需外部汇编器
+    OBJECT,
+    // 不指定-S/-c：生成目标文件后，调用链接器与运行时库链接为可执行文件
+    EXECUTABLE,
+    // -emit-llvm：LLVM IR文本（.ll）
+    LLVM_ASSEMBLY,
+    // -emit-bc：LLVM bitcode（.bc）
+    LLVM_BITCODE,
+};
+
+// 编译选项，由命令行参数解析得到
+struct Options {
+    std::string inputFilename;
+    std::string outputFilename;
+    int optLevel = 0;
+    OutputType outputType = OutputType::EXECUTABLE;
+
+    // -emit-llvm=pre-opt / -emit-bc=pre-opt：输出优化前（前端生成）的IR，默认输出优化后的IR
+    bool emitPreOpt = false;
+
+    // 输入文件为LLVM IR（.ll）或bitcode（.bc）时跳过前端，直接优化并生成代码
+    bool irInput = false;
+
+    // 目标平台triple，由--target=指定，默认为32位arm
+    std::string target;
+
+    // --run：不生成文件，在宿主机上JIT执行程序，此时目标平台固定为宿主机
+    bool run = false;
+
+    // 优化前链接运行时库输入输出函数的bitcode，使其可以被内联；--no-runtime-bitcode关闭
+    bool runtimeBitcode = true;
+
+    // --memoize：对纯递归函数自动记忆化（见src/passes/memoize.h），默认关闭
+    bool memoize = false;
+
+    // --parallel：将迭代间无依赖的循环自动并行化，由运行时库的线程池执行（见src/passes/loop_parallelize.h），默认关闭
+    bool parallel = false;
+
+    // --kernels：将矩阵乘法与二维卷积的循环嵌套替换为运行时库中的内核（见src/passes/kernel_idiom.h），默认关闭
+    bool kernels = false;
+
+    // --assume-inbounds：假定多维数组的下标不越界，依赖分析按维分析（见PassManager::assumeInboundsSubscripts），默认关闭
+    bool assumeInbounds = false;
+
+    // --tile-size=N：循环分块的块大小（内层循环的迭代次数，见src/passes/loop_tiling.h），0关闭分块
+    unsigned tileSize = 32;
+
+    // -j N：函数级优化与后端代码生成使用的线程数（模块分区数）
+    unsigned jobs = 1;
+
+    // 链接器（如arm-linux-gnueabihf-gcc），为空时自动查找
+    std::string linker;
+
+    // --cache-dir=DIR：编译缓存目录，为空时不启用缓存，默认取环境变量SYSY_CACHE_DIR
+    std::string cacheDir;
+
+    // --cache-size=SIZE：缓存目录的大小上限（字节，可带k/m/g后缀），超出时按LRU淘汰
+    uint64_t cacheSize = 256 << 20;
+
+    // --incremental：以函数为单位缓存优化后的IR，只重新优化发生变化的函数，需要同时指定缓存目录
+    bool incremental = false;
+
+    // --cache-stats：输出缓存的累计命中/未命中次数，不指定输入文件时只输出统计
+    bool cacheStats = false;
+
+    // --batch LIST：在一个进程内编译列表文件中的所有源文件，-j N指定同时编译的文件数
+    // 列表文件每行为“输入文件 [输出文件]”，省略输出文件时按-S/-c替换扩展名，#开头的行为注释
+    std::string batchFilename;
+
+    // --server[=SOCKET]：作为编译服务器常驻，接收sysy_compiler_client的请求，
+    // 套接字默认取环境变量SYSY_SERVER_SOCKET或/tmp/sysy_compiler-<uid>.sock
+    bool server = false;
+    std::string serverSocket;
+
+    static Options parse(int argc, char *argv[]);
+
+    // 根据扩展名判断输入文件是否为LLVM IR（.ll）或bitcode（.bc）
+    static bool isIRFilename(const std::string &filename);
+};
+
+#endif //SYSY_COMPILER_OPTIONS_H
@@ -0,0 +1,170 @@
+#include <map>
+#include <vector>
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/PromoteMemToReg.h>
+#include "log.h"
+#include "global_localize.h"
+
+using namespace llvm;
+
+// 内部的标量全局变量，只被load/store直接访问（地址没有被传递或保存），且访问的类型都是变量的类型
+// 类型不同的访问（如以i32读取float变量）换成alloca后无法由mem2reg提升
+static bool isPromotableGlobal(const GlobalVariable &GV) {
+    if (!GV.hasLocalLinkage() || GV.isConstant() || !GV.hasInitializer() ||
+        !GV.getValueType()->isSingleValueType() || GV.getValueType()->isVectorTy()) {
+        return false;
+    }
+    for (const User *user: GV.users()) {
+        if (auto *load = llvm::dyn_cast<LoadInst>(user)) {
+            if (!load->isSimple() || load->getType() != GV.getValueType()) {
+                return false;
+            }
+        } else if (auto *store = llvm::dyn_cast<StoreInst>(user)) {
+            if (!store->isSimple() || store->getValueOperand() == &GV ||
+                store->getValueOperand()->getType() != GV.getValueType()) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 把load/store的地址换成alloca
+static void redirectAccess(Instruction *I, AllocaInst *alloca) {
+    if (auto *load = llvm::dyn_cast<LoadInst>(I)) {
+        load->setOperand(load->getPointerOperandIndex(), alloca);
+    } else {
+        auto *store = llvm::cast<StoreInst>(I);
+        store->setOperand(store->getPointerOperandIndex(), alloca);
+    }
+}
+
+// main只执行一次，只在main中使用的全局变量改为以初始值初始化的局部变量
+static void localizeMainGlobals(Function &F, std::vector<AllocaInst *> &allocas) {
+    if (F.getName() != "main" || !F.use_empty()) {
+        return;
+    }
+    IRBuilder<> builder(&*F.getEntryBlock().getFirstInsertionPt());
+    for (GlobalVariable &GV: F.getParent()->globals()) {
+        if (GV.use_empty() || !isPromotableGlobal(GV)) {
+            continue;
+        }
+        bool onlyInMain = true;
+        for (const User *user: GV.users()) {
+            onlyInMain &= llvm::cast<Instruction>(user)->getFunction() == &F;
+        }
+        if (!onlyInMain) {
+            continue;
+        }
+
+        AllocaInst *alloca = builder.CreateAlloca(GV.getValueType(), nullptr, GV.getName() + ".local");
+        builder.CreateStore(GV.getInitializer(), alloca);
+        std::vector<Instruction *> accesses;
+        for (User *user: GV.users()) {
+            accesses.emplace_back(llvm::cast<Instruction>(user));
+        }
+        for (Instruction *I: accesses) {
+            redirectAccess(I, alloca);
+        }
+        allocas.emplace_back(alloca);
+    }
+}
+
+// 在循环L中提升可以提升的全局变量，返回提升的个数
+static unsigned promoteInLoop(Loop *L, AAResults &AA, std::vector<AllocaInst *> &allocas) {
+    BasicBlock *preheader = L->getLoopPreheader();
+    if (!preheader || !L->hasDedicatedExits()) {
+        return 0;
+    }
+
+    std::map<GlobalVariable *, std::vector<Instruction *>> accesses;
+    std::map<GlobalVariable *, bool> stored;
+    std::vector<CallBase *> calls;
+    for (BasicBlock *BB: L->blocks()) {
+        // 经由return离开循环时不经过出口，写回会丢失
+        if (llvm::isa<ReturnInst>(BB->getTerminator())) {
+            return 0;
+        }
+        for (Instruction &I: *BB) {
+            if (auto *CB = llvm::dyn_cast<CallBase>(&I)) {
+                if (CB->doesNotReturn()) {
+                    return 0;
+                }
+                calls.emplace_back(CB);
+                continue;
+            }
+            Value *ptr = getLoadStorePointerOperand(&I);
+            auto *GV = llvm::dyn_cast_or_null<GlobalVariable>(ptr);
+            if (GV && isPromotableGlobal(*GV)) {
+                accesses[GV].emplace_back(&I);
+                stored[GV] |= llvm::isa<StoreInst>(I);
+            }
+        }
+    }
+
+    unsigned promoted = 0;
+    for (auto &[GV, instructions]: accesses) {
+        // 只有load时LICM已经外提，不需要写回
+        if (!stored[GV]) {
+            continue;
+        }
+        MemoryLocation location = MemoryLocation::getBeforeOrAfter(GV);
+        bool clobbered = false;
+        for (CallBase *CB: calls) {
+            clobbered |= !isNoModRef(AA.getModRefInfo(CB, location));
+        }
+        if (clobbered) {
+            continue;
+        }
+
+        Function *F = preheader->getParent();
+        IRBuilder<> builder(&*F->getEntryBlock().getFirstInsertionPt());
+        AllocaInst *alloca = builder.CreateAlloca(GV->getValueType(), nullptr, GV->getName() + ".promoted");
+        builder.SetInsertPoint(preheader->getTerminator());
+        builder.CreateStore(builder.CreateLoad(GV->getValueType(), GV), alloca);
+        for (Instruction *I: instructions) {
+            redirectAccess(I, alloca);
+        }
+        SmallVector<BasicBlock *, 4> exits;
+        L->getUniqueExitBlocks(exits);
+        for (BasicBlock *exit: exits) {
+            builder.SetInsertPoint(&*exit->getFirstInsertionPt());
+            builder.CreateStore(builder.CreateLoad(GV->getValueType(), alloca), GV);
+        }
+        allocas.emplace_back(alloca);
+        promoted++;
+    }
+    return promoted;
+}
+
+PreservedAnalyses GlobalLocalizePass::run(Function &F, FunctionAnalysisManager &AM) {
+    std::vector<AllocaInst *> allocas;
+    localizeMainGlobals(F, allocas);
+    size_t localized = allocas.size();
+
+    // 先在外层循环中提升，内层循环中的访问随之被替换；外层有访问该变量的调用时再尝试内层
+    LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+    AAResults &AA = AM.getResult<AAManager>(F);
+    unsigned promoted = 0;
+    for (Loop *L: LI.getLoopsInPreorder()) {
+        promoted += promoteInLoop(L, AA, allocas);
+    }
+
+    if (allocas.empty()) {
+        return PreservedAnalyses::all();
+    }
+    PromoteMemToReg(allocas, AM.getResult<DominatorTreeAnalysis>(F), &AM.getResult<AssumptionAnalysis>(F));
+    log("globals") << F.getName().str() << ": " << localized << " globals localized, "
+                   << promoted << " promoted in loops" << std::endl;
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
@@ -0,0 +1,19 @@
+#ifndef SYSY_COMPILER_PASSES_GLOBAL_LOCALIZE_H
+#define SYSY_COMPILER_PASSES_GLOBAL_LOCALIZE_H
+
+#include <llvm/IR/PassManager.h>
+
+// 标量全局变量的局部化与循环中的提升，在函数化简管道的末尾运行（被调函数已内联）
+// 前端把SysY的全局变量都生成为InternalLinkage的全局变量，main中的循环通过内存读写它们：
+// 1. 只在main中使用的标量全局变量（main不被调用，只执行一次）改为main入口的alloca并以初始值初始化，
+//    GlobalOpt要求变量在函数入口处是死的，先读后写（如累加到初始值上）时不会处理
+// 2. 其余的标量全局变量在循环中有store、循环中的调用都不访问它（别名分析给出的函数属性）时，
+//    在preheader中读入、各出口写回，循环中只使用寄存器；LICM只在每次迭代都写入时才提升，
+//    SysY程序是单线程的，条件写入时在出口写回未修改的值对程序不可见
+// 两种情况都先换成alloca再由mem2reg构造phi；循环中有return时不能在出口写回，不处理
+class GlobalLocalizePass : public llvm::PassInfoMixin<GlobalLocalizePass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+#endif //SYSY_COMPILER_PASSES_GLOBAL_LOCALIZE_H
@@ -0,0 +1,205 @@
+#include <map>
+#include <tuple>
+#include <vector>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
+#include "log.h"
+#include "invariant_division.h"
+
+using namespace llvm;
+
+// 每次进入计算倒数的循环时除法至少执行这么多次才处理（迭代次数都是常量时按乘积估计）
+static constexpr unsigned minExecutions = 4;
+
+namespace {
+    // 在preheader中为一个除数预先计算的值，取模与除法各自需要的部分在第一次用到时生成
+    struct InvariantDivisor {
+        // 生成的位置（preheader的末尾）
+        Instruction *insertPoint;
+        // 除数的绝对值（无符号）
+        Value *divisor;
+        // 除数为0时换成1，只用于预先计算的除法
+        Value *safeDivisor;
+        // ⌊(2^32 - 1) / divisor⌋
+        Value *reciprocal = nullptr;
+        // ⌊2^32 * (2^l - divisor) / divisor⌋ + 1，l = ⌈log2(divisor)⌉
+        Value *magic = nullptr;
+        // min(l, 1)与max(l - 1, 0)
+        Value *shift1 = nullptr, *shift2 = nullptr;
+    };
+}
+
+static bool isNonNegative(Value *V, Instruction *at, ScalarEvolution &SE, DominatorTree &DT) {
+    return SE.isKnownNonNegative(SE.getSCEV(V)) ||
+           isKnownNonNegative(V, at->getModule()->getDataLayout(), 0, nullptr, at, &DT);
+}
+
+static bool isPositive(Value *V, Instruction *at, ScalarEvolution &SE, DominatorTree &DT) {
+    return SE.isKnownPositive(SE.getSCEV(V)) ||
+           isKnownPositive(V, at->getModule()->getDataLayout(), 0, nullptr, at, &DT);
+}
+
+// 除数不变的最外层循环，其preheader用于计算倒数；没有preheader或执行次数太少时返回nullptr
+static Loop *getHoistLoop(Instruction *I, Value *divisor, LoopInfo &LI, ScalarEvolution &SE) {
+    Loop *L = LI.getLoopFor(I->getParent());
+    if (!L || !L->isLoopInvariant(divisor)) {
+        return nullptr;
+    }
+    uint64_t executions = 1;
+    for (;;) {
+        unsigned tripCount = SE.getSmallConstantMaxTripCount(L);
+        executions = tripCount == 0 || executions >= minExecutions ? minExecutions : executions * tripCount;
+        Loop *parent = L->getParentLoop();
+        if (!parent || !parent->isLoopInvariant(divisor) || !parent->getLoopPreheader()) {
+            break;
+        }
+        L = parent;
+    }
+    return L->getLoopPreheader() && executions >= minExecutions ? L : nullptr;
+}
+
+// 32x32→64位无符号乘法的高32位
+static Value *createMulHigh(IRBuilder<> &builder, Value *a, Value *b) {
+    Type *int64Ty = builder.getInt64Ty();
+    Value *product = builder.CreateMul(builder.CreateZExt(a, int64Ty), builder.CreateZExt(b, int64Ty));
+    return builder.CreateTrunc(builder.CreateLShr(product, 32), a->getType());
+}
+
+// x mod divisor，x为无符号的被除数
+static Value *reduce(IRBuilder<> &builder, Value *x, InvariantDivisor &d) {
+    if (!d.reciprocal) {
+        IRBuilder<> preheader(d.insertPoint);
+        d.reciprocal = preheader.CreateUDiv(preheader.getInt32(UINT32_MAX), d.safeDivisor, "barrett.reciprocal");
+    }
+    Value *quotient = createMulHigh(builder, x, d.reciprocal);
+    Value *remainder = builder.CreateSub(x, builder.CreateMul(quotient, d.divisor));
+    return builder.CreateSelect(
+            builder.CreateICmpUGE(remainder, d.divisor),
+            builder.CreateSub(remainder, d.divisor),
+            remainder,
+            "barrett.r"
+    );
+}
+
+// x / divisor，x为无符号的被除数
+// Granlund-Montgomery的无分支形式：t = ⌊x * magic / 2^32⌋，q = (t + ((x - t) >> shift1)) >> shift2，
+// 对1到2^32 - 1的所有除数成立，除数为±1或2的幂时不需要单独的分支
+static Value *divide(IRBuilder<> &builder, Value *x, InvariantDivisor &d) {
+    if (!d.magic) {
+        IRBuilder<> preheader(d.insertPoint);
+        Type *int32Ty = preheader.getInt32Ty(), *int64Ty = preheader.getInt64Ty();
+        Value *leadingZeros = preheader.CreateBinaryIntrinsic(
+                Intrinsic::ctlz, preheader.CreateSub(d.safeDivisor, preheader.getInt32(1)), preheader.getFalse()
+        );
+        Value *bits = preheader.CreateSub(preheader.getInt32(32), leadingZeros);
+        // 2^l - divisor < divisor，左移32位后不超过64位
+        Value *divisor64 = preheader.CreateZExt(d.safeDivisor, int64Ty);
+        Value *numerator = preheader.CreateShl(
+                preheader.CreateSub(preheader.CreateShl(preheader.getInt64(1), preheader.CreateZExt(bits, int64Ty)),
+                                    divisor64),
+                32
+        );
+        d.magic = preheader.CreateAdd(
+                preheader.CreateTrunc(preheader.CreateUDiv(numerator, divisor64), int32Ty),
+                preheader.getInt32(1),
+                "division.magic"
+        );
+        Value *isOne = preheader.CreateICmpEQ(bits, preheader.getInt32(0));
+        d.shift1 = preheader.CreateZExt(preheader.CreateNot(isOne), int32Ty);
+        d.shift2 = preheader.CreateSelect(isOne, preheader.getInt32(0), preheader.CreateSub(bits, preheader.getInt32(1)));
+    }
+    Value *t = createMulHigh(builder, x, d.magic);
+    Value *sum = builder.CreateAdd(t, builder.CreateLShr(builder.CreateSub(x, t), d.shift1));
+    return builder.CreateLShr(sum, d.shift2, "division.q");
+}
+
+PreservedAnalyses InvariantDivisionPass::run(Function &F, FunctionAnalysisManager &AM) {
+    LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+    ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+
+    std::vector<BinaryOperator *> divisions;
+    for (BasicBlock &BB: F) {
+        for (Instruction &I: BB) {
+            auto *binary = llvm::dyn_cast<BinaryOperator>(&I);
+            if (binary && binary->isIntDivRem() &&
+                binary->getType()->isIntegerTy(32) && !llvm::isa<Constant>(binary->getOperand(1))) {
+                divisions.emplace_back(binary);
+            }
+        }
+    }
+
+    // 同一循环中除数相同、符号相同的除法与取模共用预先计算的值
+    // 有符号时预先计算基于|m|，无符号时基于m本身，两者不能混用
+    std::map<std::tuple<Loop *, Value *, bool>, InvariantDivisor> divisors;
+    unsigned remainders = 0, quotients = 0;
+    for (BinaryOperator *I: divisions) {
+        Value *x = I->getOperand(0), *m = I->getOperand(1);
+        Loop *L = getHoistLoop(I, m, LI, SE);
+        if (!L) {
+            continue;
+        }
+        bool isSigned = I->getOpcode() == Instruction::SRem || I->getOpcode() == Instruction::SDiv;
+        bool isRemainder = I->getOpcode() == Instruction::SRem || I->getOpcode() == Instruction::URem;
+
+        auto it = divisors.find({L, m, isSigned});
+        if (it == divisors.end()) {
+            IRBuilder<> builder(L->getLoopPreheader()->getTerminator());
+            Value *divisor = m, *safeDivisor = m;
+            if (!isSigned || !isPositive(m, L->getLoopPreheader()->getTerminator(), SE, DT)) {
+                if (isSigned) {
+                    divisor = builder.CreateSelect(
+                            builder.CreateICmpSLT(m, builder.getInt32(0)),
+                            builder.CreateNeg(m),
+                            m
+                    );
+                }
+                // 除数为0时原来的取模是未定义行为，但不能让preheader中的除法出错
+                safeDivisor = builder.CreateSelect(
+                        builder.CreateICmpEQ(divisor, builder.getInt32(0)),
+                        builder.getInt32(1),
+                        divisor
+                );
+            }
+            it = divisors.insert({{L, m, isSigned}, {L->getLoopPreheader()->getTerminator(), divisor, safeDivisor}}).first;
+        }
+
+        IRBuilder<> builder(I);
+        bool xNonNegative = !isSigned || isNonNegative(x, I, SE, DT);
+        Value *negative = xNonNegative ? nullptr : builder.CreateICmpSLT(x, builder.getInt32(0));
+        Value *absolute = xNonNegative ? x : builder.CreateSelect(negative, builder.CreateNeg(x), x);
+        Value *result;
+        if (isRemainder) {
+            result = reduce(builder, absolute, it->second);
+            if (!xNonNegative) {
+                result = builder.CreateSelect(negative, builder.CreateNeg(result), result);
+            }
+            remainders++;
+        } else {
+            result = divide(builder, absolute, it->second);
+            // 商的符号为被除数与除数符号的异或：sign为0或-1，(q ^ sign) - sign
+            if (isSigned && (!xNonNegative || !isPositive(m, I, SE, DT))) {
+                Value *sign = builder.CreateAShr(builder.CreateXor(x, m), 31);
+                result = builder.CreateSub(builder.CreateXor(result, sign), sign);
+            }
+            quotients++;
+        }
+        result->takeName(I);
+        SE.forgetValue(I);
+        I->replaceAllUsesWith(result);
+        I->eraseFromParent();
+    }
+    if (remainders + quotients == 0) {
+        return PreservedAnalyses::all();
+    }
+    log("division") << F.getName().str() << ": " << quotients << " divisions and " << remainders
+                    << " remainders by loop-invariant divisors lowered to multiplications" << std::endl;
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
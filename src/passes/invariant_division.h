@@ -0,0 +1,20 @@
+#ifndef SYSY_COMPILER_PASSES_INVARIANT_DIVISION_H
+#define SYSY_COMPILER_PASSES_INVARIANT_DIVISION_H
+
+#include <llvm/IR/PassManager.h>
+
+// 循环中除数为循环不变量（非常量）的int除法与取模（-O2及以上）
+// LLVM只对常量除数用乘法代替除法，arm上每次除法都调用__aeabi_idiv(mod)，x86上为idiv
+// 在除数不变的最外层循环的preheader中预先计算（每次进入循环只做一次除法），循环中只有乘法与移位：
+// 1. 取模：R = ⌊(2^32 - 1) / |m|⌋，q = ⌊|x| * R / 2^32⌋（32x32→64位乘法取高位）与真实的商相差至多1，
+//    r = |x| - q * |m|，r ≥ |m|时再减去|m|（Barrett约简）；srem的结果与被除数同号
+// 2. 除法：运行时计算magic number（libdivide的做法），q = (t + ((|x| - t) >> s1)) >> s2，t = ⌊|x| * magic / 2^32⌋，
+//    对所有非0除数成立（包括±1），结果的符号为两个操作数符号的异或
+// 除数为0时原来是未定义行为，预先计算中换成1；值域分析已知非负的被除数、为正的除数省略取绝对值；
+// 每次进入循环执行次数很少的除法不处理
+class InvariantDivisionPass : public llvm::PassInfoMixin<InvariantDivisionPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+#endif //SYSY_COMPILER_PASSES_INVARIANT_DIVISION_H
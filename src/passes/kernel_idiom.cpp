@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+#include <llvm/Analysis/IVDescriptors.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/ScalarEvolutionExpander.h>
+#include "log.h"
+#include "kernel_idiom.h"
+#include "loop_utils.h"
+
+using namespace llvm;
+
+// 迭代次数都是常量且乘加次数少于此值时不替换，调用的开销相对较大，原循环也可能被完全展开
+static constexpr uint64_t minWork = 4096;
+
+namespace {
+    // 地址 = base + Σ strides[l] * 第l层循环的迭代序号，步长以字节为单位
+    struct Access {
+        const SCEV *base = nullptr;
+        std::vector<int64_t> strides;
+        // 基对象未知（数组参数），需要在运行时检查地址范围与结果不重叠
+        bool checkOverlap = false;
+    };
+
+    struct Candidate {
+        // 从外到内，3层为矩阵乘法，4层为卷积；前两层对应结果的两维，其余为归约
+        std::vector<Loop *> nest;
+        std::vector<const SCEV *> backedgeTakenCounts;
+        Type *elementType = nullptr;
+        // 矩阵乘法中为c、a、b，卷积中为o、x、w
+        Access result, lhs, rhs;
+        // 结果的初值为原来的值（否则为0）
+        bool accumulate = false;
+
+        // 修改控制流之前在最外层循环的preheader中展开
+        std::vector<Value *> backedgeTakenValues;
+        Value *resultBase = nullptr, *lhsBase = nullptr, *rhsBase = nullptr;
+    };
+}
+
+// 头部的phi为一个整数归纳变量，以及至多一个其他phi（归约的累加值，通过acc返回）
+static bool matchPhis(Loop *L, ScalarEvolution &SE, PHINode *&acc) {
+    acc = nullptr;
+    unsigned inductions = 0;
+    for (PHINode &phi: L->getHeader()->phis()) {
+        InductionDescriptor induction;
+        if (phi.getType()->isIntegerTy() && InductionDescriptor::isInductionPHI(&phi, L, &SE, induction)) {
+            inductions++;
+        } else if (!acc) {
+            acc = &phi;
+        } else {
+            return false;
+        }
+    }
+    return inductions == 1;
+}
+
+// 最内层的累加acc + x * y（int为add/mul，float为fadd/fmul），x与y为最内层循环中的load
+static bool matchMultiplyAdd(PHINode *acc, Loop *L, LoadInst *&x, LoadInst *&y) {
+    bool isFloat = acc->getType()->isFloatTy();
+    if (!isFloat && !acc->getType()->isIntegerTy(32)) {
+        return false;
+    }
+    auto *next = llvm::dyn_cast<BinaryOperator>(acc->getIncomingValueForBlock(L->getLoopLatch()));
+    if (!next || next->getOpcode() != (isFloat ? Instruction::FAdd : Instruction::Add)) {
+        return false;
+    }
+    Value *other = next->getOperand(0) == acc ? next->getOperand(1) :
+                   next->getOperand(1) == acc ? next->getOperand(0) : nullptr;
+    auto *product = llvm::dyn_cast_or_null<BinaryOperator>(other);
+    if (!product || product->getOpcode() != (isFloat ? Instruction::FMul : Instruction::Mul) ||
+        !product->hasOneUse()) {
+        return false;
+    }
+    x = llvm::dyn_cast<LoadInst>(product->getOperand(0));
+    y = llvm::dyn_cast<LoadInst>(product->getOperand(1));
+    return x && y && x->isSimple() && y->isSimple() && L->contains(x) && L->contains(y);
+}
+
+// use是否为循环L中的value在循环之后的值：value本身或退出块中的LCSSA phi
+static bool isExitValue(Value *use, Value *value, Loop *L) {
+    if (use == value) {
+        return true;
+    }
+    auto *phi = llvm::dyn_cast<PHINode>(use);
+    return phi && phi->getParent() == L->getExitBlock() &&
+           llvm::all_of(phi->incoming_values(), [&](Value *incoming) { return incoming == value; });
+}
+
+// 将地址分解为基址与各层循环的常量步长，基址在整个嵌套中不变
+static bool decompose(const SCEV *address, const std::vector<Loop *> &nest, ScalarEvolution &SE, Access &access) {
+    access.strides.assign(nest.size(), 0);
+    while (auto *addRec = llvm::dyn_cast<SCEVAddRecExpr>(address)) {
+        auto it = std::find(nest.begin(), nest.end(), addRec->getLoop());
+        auto *step = llvm::dyn_cast<SCEVConstant>(addRec->getStepRecurrence(SE));
+        if (it == nest.end() || !addRec->isAffine() || !step || step->getAPInt().getMinSignedBits() > 64) {
+            return false;
+        }
+        access.strides[it - nest.begin()] = step->getAPInt().getSExtValue();
+        address = addRec->getStart();
+    }
+    access.base = address;
+    return SE.isLoopInvariant(address, nest.front()) && isSafeToExpand(address, SE);
+}
+
+// 地址所在的全局变量或局部数组，其他情况（如数组参数）返回nullptr
+static const Value *getObject(const Access &access, ScalarEvolution &SE) {
+    auto *base = llvm::dyn_cast<SCEVUnknown>(SE.getPointerBase(access.base));
+    if (!base) {
+        return nullptr;
+    }
+    const Value *object = getUnderlyingObject(base->getValue());
+    return llvm::isa<GlobalVariable>(object) || llvm::isa<AllocaInst>(object) ? object : nullptr;
+}
+
+// 步长是元素大小的倍数，且以元素为单位时在int范围内
+// 另外限制在2^28字节以内，运行时计算地址范围时（步长 * 迭代次数，至多4层）不会超出64位
+static bool isElementStride(int64_t stride, int64_t elementSize) {
+    return stride % elementSize == 0 && stride / elementSize >= INT_MIN && stride / elementSize <= INT_MAX &&
+           std::abs(stride) < (int64_t(1) << 28);
+}
+
+// 检查循环嵌套能否替换为内核，不能时返回原因
+static const char *analyze(Candidate &candidate, ScalarEvolution &SE, DominatorTree &DT) {
+    const std::vector<Loop *> &nest = candidate.nest;
+    unsigned depth = nest.size();
+    for (unsigned l = 0; l < depth; l++) {
+        if (!isCanonicalLoop(nest[l])) {
+            return "not in canonical form";
+        }
+        if (l + 1 < depth && !DT.dominates(nest[l + 1]->getLoopPreheader(), nest[l]->getLoopLatch())) {
+            return "inner loop not entered in every iteration";
+        }
+        const SCEV *backedgeTakenCount = SE.getBackedgeTakenCount(nest[l]);
+        if (llvm::isa<SCEVCouldNotCompute>(backedgeTakenCount) ||
+            backedgeTakenCount->getType()->getIntegerBitWidth() < 32 ||
+            !SE.isLoopInvariant(backedgeTakenCount, nest.front()) ||
+            !isSafeToExpand(backedgeTakenCount, SE)) {
+            return "trip count unknown or not invariant in the nest";
+        }
+        candidate.backedgeTakenCounts.emplace_back(backedgeTakenCount);
+    }
+    if (!nest.front()->getExitBlock()->phis().empty()) {
+        return "values used after the nest";
+    }
+
+    std::vector<PHINode *> accs(depth);
+    for (unsigned l = 0; l < depth; l++) {
+        if (!matchPhis(nest[l], SE, accs[l]) || (l < 2) != (accs[l] == nullptr)) {
+            return "recurrence other than induction and reduction";
+        }
+    }
+    LoadInst *x, *y;
+    if (!matchMultiplyAdd(accs.back(), nest.back(), x, y)) {
+        return "no multiply-accumulate in the innermost loop";
+    }
+    candidate.elementType = accs.back()->getType();
+
+    // 累加值从内向外逐层传递：内层的初值为外层的累加值，外层的新值为内层的结果
+    Value *sum = accs.back()->getIncomingValueForBlock(nest.back()->getLoopLatch());
+    for (unsigned l = depth - 2; l >= 2; l--) {
+        Value *incoming = accs[l]->getIncomingValueForBlock(nest[l]->getLoopLatch());
+        if (!isExitValue(incoming, sum, nest[l + 1]) ||
+            accs[l + 1]->getIncomingValueForBlock(nest[l + 1]->getLoopPreheader()) != accs[l]) {
+            return "reduction not nested";
+        }
+        sum = incoming;
+    }
+
+    StoreInst *store = nullptr;
+    std::vector<LoadInst *> loads;
+    for (BasicBlock *BB: nest.front()->blocks()) {
+        for (Instruction &I: *BB) {
+            if (!I.mayReadOrWriteMemory()) {
+                continue;
+            }
+            auto *load = llvm::dyn_cast<LoadInst>(&I);
+            auto *S = llvm::dyn_cast<StoreInst>(&I);
+            if (load && load->isSimple()) {
+                loads.emplace_back(load);
+            } else if (S && S->isSimple() && !store) {
+                store = S;
+            } else {
+                return "calls or other memory accesses";
+            }
+        }
+    }
+    if (!store || !nest[1]->contains(store) || nest[2]->contains(store) ||
+        !isExitValue(store->getValueOperand(), sum, nest[2])) {
+        return "result not stored after the reduction";
+    }
+    // 内核写入结果的每个元素，store必须在第2层循环的每次迭代中都执行（不能在条件分支中）
+    if (!DT.dominates(store->getParent(), nest[1]->getLoopLatch())) {
+        return "result not stored in every iteration";
+    }
+
+    // 初值为0或从结果的地址读取
+    Value *init = accs[2]->getIncomingValueForBlock(nest[2]->getLoopPreheader());
+    auto *initLoad = llvm::dyn_cast<LoadInst>(init);
+    const SCEV *resultAddress = SE.getSCEV(store->getPointerOperand());
+    if (initLoad && nest[1]->contains(initLoad) && !nest[2]->contains(initLoad) &&
+        DT.dominates(initLoad->getParent(), nest[1]->getLoopLatch()) &&
+        SE.getSCEV(initLoad->getPointerOperand()) == resultAddress) {
+        candidate.accumulate = true;
+    } else if (!llvm::isa<Constant>(init) || !llvm::cast<Constant>(init)->isNullValue()) {
+        return "initial value neither zero nor the stored element";
+    }
+    for (LoadInst *load: loads) {
+        if (load != x && load != y && !(candidate.accumulate && load == initLoad)) {
+            return "other loads in the nest";
+        }
+    }
+
+    if (!decompose(resultAddress, nest, SE, candidate.result) ||
+        !decompose(SE.getSCEV(x->getPointerOperand()), nest, SE, candidate.lhs) ||
+        !decompose(SE.getSCEV(y->getPointerOperand()), nest, SE, candidate.rhs)) {
+        return "addresses not affine in the loop variables";
+    }
+    const Value *resultObject = getObject(candidate.result, SE);
+    if (!resultObject) {
+        return "result not a global variable or local array";
+    }
+    for (Access *operand: {&candidate.lhs, &candidate.rhs}) {
+        const Value *object = getObject(*operand, SE);
+        if (object == resultObject) {
+            return "result may alias an operand";
+        }
+        operand->checkOverlap = !object;
+    }
+    int64_t elementSize = nest.front()->getHeader()->getModule()->getDataLayout().getTypeAllocSize(
+            candidate.elementType
+    );
+    for (const Access *access: {&candidate.result, &candidate.lhs, &candidate.rhs}) {
+        for (int64_t stride: access->strides) {
+            if (!isElementStride(stride, elementSize)) {
+                return "unsupported strides";
+            }
+        }
+    }
+    if (candidate.result.strides[0] == 0 || candidate.result.strides[1] == 0) {
+        return "result does not depend on both outer loops";
+    }
+
+    // 矩阵乘法：a与第2层循环无关，b与第1层无关；卷积：w与前两层循环都无关
+    auto independentOf = [](const Access &access, std::initializer_list<unsigned> levels) {
+        return llvm::all_of(levels, [&](unsigned l) { return access.strides[l] == 0; });
+    };
+    if (depth == 3) {
+        if (!independentOf(candidate.lhs, {1}) || !independentOf(candidate.rhs, {0})) {
+            std::swap(candidate.lhs, candidate.rhs);
+        }
+        if (!independentOf(candidate.lhs, {1}) || !independentOf(candidate.rhs, {0})) {
+            return "operands not a matrix product";
+        }
+        // 两个操作数都沿归约连续时，原循环的整数点积可以直接向量化，比内核快（512^3时19 ms对55 ms）；
+        // 内核按基线指令集编译，x86-64没有32位整数的向量乘法。float的归约不能重排，仍然替换
+        if (candidate.elementType->isIntegerTy() &&
+            candidate.lhs.strides[2] == elementSize && candidate.rhs.strides[2] == elementSize) {
+            return "integer dot products vectorize in place";
+        }
+    } else {
+        if (!independentOf(candidate.rhs, {0, 1})) {
+            std::swap(candidate.lhs, candidate.rhs);
+        }
+        if (!independentOf(candidate.rhs, {0, 1})) {
+            return "no operand independent of the outer loops";
+        }
+    }
+
+    uint64_t work = 1;
+    for (const SCEV *backedgeTakenCount: candidate.backedgeTakenCounts) {
+        auto *constant = llvm::dyn_cast<SCEVConstant>(backedgeTakenCount);
+        if (!constant || constant->getAPInt().uge(minWork)) {
+            work = minWork;
+            break;
+        }
+        work *= constant->getAPInt().getZExtValue() + 1;
+        if (work >= minWork) {
+            break;
+        }
+    }
+    if (work < minWork) {
+        return "too little work";
+    }
+    return nullptr;
+}
+
+// 在最外层循环的preheader中检查迭代次数与结果的地址，满足时调用内核后跳转到嵌套的出口，否则执行原循环
+static void replace(Function &F, const Candidate &candidate) {
+    LLVMContext &ctx = F.getContext();
+    const std::vector<Loop *> &nest = candidate.nest;
+    Loop *outer = nest.front();
+    BasicBlock *preheader = outer->getLoopPreheader();
+    Type *int32Ty = Type::getInt32Ty(ctx), *int64Ty = Type::getInt64Ty(ctx);
+    int64_t elementSize = F.getParent()->getDataLayout().getTypeAllocSize(candidate.elementType);
+
+    // 迭代次数在[1, INT_MAX]内；回边次数为全1时迭代次数回绕为0
+    IRBuilder<> builder(preheader->getTerminator());
+    Value *valid = builder.getTrue();
+    std::vector<Value *> counts;
+    for (Value *backedgeTaken: candidate.backedgeTakenValues) {
+        valid = builder.CreateAnd(valid, builder.CreateICmpULT(
+                backedgeTaken,
+                ConstantInt::get(backedgeTaken->getType(), INT_MAX)
+        ));
+        counts.emplace_back(builder.CreateAdd(
+                builder.CreateZExtOrTrunc(backedgeTaken, int32Ty),
+                builder.getInt32(1),
+                "kernel.count"
+        ));
+    }
+    // 结果的各元素地址互不相同：一层循环覆盖的范围不超过另一层的步长
+    auto within = [&](unsigned inner, unsigned outer) {
+        return builder.CreateICmpULE(
+                builder.CreateMul(
+                        builder.CreateZExt(counts[inner], int64Ty),
+                        builder.getInt64(std::abs(candidate.result.strides[inner]))
+                ),
+                builder.getInt64(std::abs(candidate.result.strides[outer]))
+        );
+    };
+    valid = builder.CreateAnd(valid, builder.CreateOr(within(1, 0), within(0, 1)));
+
+    // 访问的地址范围[begin, end)，步长为负时向低地址延伸
+    auto range = [&](const Access &access, Value *base) {
+        Value *begin = builder.CreatePtrToInt(base, int64Ty), *end = begin;
+        for (unsigned l = 0; l < access.strides.size(); l++) {
+            if (access.strides[l] == 0) {
+                continue;
+            }
+            Value *extent = builder.CreateMul(
+                    builder.CreateSub(builder.CreateZExt(counts[l], int64Ty), builder.getInt64(1)),
+                    builder.getInt64(access.strides[l])
+            );
+            if (access.strides[l] < 0) {
+                begin = builder.CreateAdd(begin, extent);
+            } else {
+                end = builder.CreateAdd(end, extent);
+            }
+        }
+        return std::make_pair(begin, builder.CreateAdd(end, builder.getInt64(elementSize)));
+    };
+    // 数组参数可能指向结果数组，其范围与结果的范围不相交时才能调用内核
+    auto [resultBegin, resultEnd] = range(candidate.result, candidate.resultBase);
+    for (auto [access, base]: {std::make_pair(&candidate.lhs, candidate.lhsBase),
+                               std::make_pair(&candidate.rhs, candidate.rhsBase)}) {
+        if (!access->checkOverlap) {
+            continue;
+        }
+        auto [begin, end] = range(*access, base);
+        valid = builder.CreateAnd(valid, builder.CreateOr(
+                builder.CreateICmpULE(resultEnd, begin),
+                builder.CreateICmpULE(end, resultBegin)
+        ));
+    }
+    valid->setName("kernel.valid");
+
+    BasicBlock *kernel = BasicBlock::Create(ctx, "kernel", &F, outer->getHeader());
+    preheader->getTerminator()->eraseFromParent();
+    builder.SetInsertPoint(preheader);
+    builder.CreateCondBr(valid, kernel, outer->getHeader());
+
+    builder.SetInsertPoint(kernel);
+    Type *pointerTy = candidate.elementType->getPointerTo();
+    auto stride = [&](const Access &access, unsigned l) {
+        return builder.getInt32(access.strides[l] / elementSize);
+    };
+    std::vector<Value *> args(counts);
+    args.emplace_back(builder.CreateBitCast(candidate.resultBase, pointerTy));
+    args.emplace_back(stride(candidate.result, 0));
+    args.emplace_back(stride(candidate.result, 1));
+    std::string name;
+    if (nest.size() == 3) {
+        name = "_sysy_matmul_";
+        args.emplace_back(builder.CreateBitCast(candidate.lhsBase, pointerTy));
+        args.emplace_back(stride(candidate.lhs, 0));
+        args.emplace_back(stride(candidate.lhs, 2));
+        args.emplace_back(builder.CreateBitCast(candidate.rhsBase, pointerTy));
+        args.emplace_back(stride(candidate.rhs, 2));
+        args.emplace_back(stride(candidate.rhs, 1));
+    } else {
+        name = "_sysy_conv2d_";
+        args.emplace_back(builder.CreateBitCast(candidate.lhsBase, pointerTy));
+        for (unsigned l = 0; l < 4; l++) {
+            args.emplace_back(stride(candidate.lhs, l));
+        }
+        args.emplace_back(builder.CreateBitCast(candidate.rhsBase, pointerTy));
+        args.emplace_back(stride(candidate.rhs, 2));
+        args.emplace_back(stride(candidate.rhs, 3));
+    }
+    name += candidate.elementType->isFloatTy() ? "f32" : "i32";
+    args.emplace_back(builder.getInt32(candidate.accumulate));
+
+    std::vector<Type *> params;
+    for (Value *arg: args) {
+        params.emplace_back(arg->getType());
+    }
+    FunctionCallee callee = F.getParent()->getOrInsertFunction(
+            name,
+            FunctionType::get(Type::getVoidTy(ctx), params, false)
+    );
+    if (auto *declaration = llvm::dyn_cast<Function>(callee.getCallee())) {
+        declaration->addFnAttr(Attribute::NoUnwind);
+    }
+    builder.CreateCall(callee, args);
+    builder.CreateBr(outer->getExitBlock());
+}
+
+PreservedAnalyses KernelIdiomPass::run(Function &F, FunctionAnalysisManager &AM) {
+    LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+    ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+
+    // 先序遍历，嵌套可以在其他循环中（如重复计算的外层循环）；已选中的嵌套中的循环不再处理
+    std::vector<Candidate> candidates;
+    for (Loop *L: LI.getLoopsInPreorder()) {
+        if (!candidates.empty() && candidates.back().nest.front()->contains(L)) {
+            continue;
+        }
+        Candidate candidate;
+        candidate.nest.emplace_back(L);
+        while (candidate.nest.back()->getSubLoops().size() == 1) {
+            candidate.nest.emplace_back(candidate.nest.back()->getSubLoops().front());
+        }
+        if (!candidate.nest.back()->getSubLoops().empty() ||
+            (candidate.nest.size() != 3 && candidate.nest.size() != 4)) {
+            continue;
+        }
+        if (const char *reason = analyze(candidate, SE, DT)) {
+            log("kernel") << F.getName().str() << ": loop " << L->getHeader()->getName().str()
+                          << " not replaced: " << reason << std::endl;
+            continue;
+        }
+        candidates.emplace_back(std::move(candidate));
+    }
+    if (candidates.empty()) {
+        return PreservedAnalyses::all();
+    }
+
+    // 修改控制流之前展开所有迭代次数与基址
+    SCEVExpander expander(SE, F.getParent()->getDataLayout(), "kernel");
+    for (Candidate &candidate: candidates) {
+        Instruction *insertPoint = candidate.nest.front()->getLoopPreheader()->getTerminator();
+        for (const SCEV *backedgeTakenCount: candidate.backedgeTakenCounts) {
+            candidate.backedgeTakenValues.emplace_back(
+                    expander.expandCodeFor(backedgeTakenCount, nullptr, insertPoint)
+            );
+        }
+        candidate.resultBase = expander.expandCodeFor(candidate.result.base, nullptr, insertPoint);
+        candidate.lhsBase = expander.expandCodeFor(candidate.lhs.base, nullptr, insertPoint);
+        candidate.rhsBase = expander.expandCodeFor(candidate.rhs.base, nullptr, insertPoint);
+    }
+
+    for (const Candidate &candidate: candidates) {
+        log("kernel") << F.getName().str() << ": loop " << candidate.nest.front()->getHeader()->getName().str()
+                      << " replaced by " << (candidate.nest.size() == 3 ? "matmul" : "conv2d") << std::endl;
+        replace(F, candidate);
+    }
+    return PreservedAnalyses::none();
+}
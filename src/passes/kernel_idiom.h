@@ -0,0 +1,21 @@
+#ifndef SYSY_COMPILER_PASSES_KERNEL_IDIOM_H
+#define SYSY_COMPILER_PASSES_KERNEL_IDIOM_H
+
+#include <llvm/IR/PassManager.h>
+
+// 矩阵乘法与二维卷积的识别（--kernels开启），整个循环嵌套替换为运行时库中分块的内核
+// 1. 三层循环：c[i][j] = (c[i][j]或0) + Σk a[i][k] * b[k][j] → _sysy_matmul_i32/f32
+// 2. 四层循环：o[i][j] = (o[i][j]或0) + Σp Σq x[..] * w[p][q] → _sysy_conv2d_i32/f32，x的下标可以是i、j、p、q的任意仿射组合
+// 条件：
+// 1. 每层循环是规范形式、只有一个子循环且每次迭代都进入子循环，迭代次数在整个嵌套中不变
+// 2. 最内层的归约之外没有其他phi，嵌套中只有两个操作数的load与结果的load/store，没有其他访问内存的指令
+// 3. 所有地址都是循环变量的仿射函数（步长为常量），结果数组是不同于操作数的全局变量或局部数组
+// 4. 整数矩阵乘法的两个操作数不能都沿归约连续（如c[i][j] += a[i][k] * b[j][k]），这种点积原循环向量化后更快
+// 运行时再检查结果的各元素地址互不相同，以及为数组参数的操作数的地址范围与结果不重叠，不满足时执行原循环
+// 内核中每个元素的乘积按原来的顺序累加，float的结果与原循环相同
+class KernelIdiomPass : public llvm::PassInfoMixin<KernelIdiomPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+#endif //SYSY_COMPILER_PASSES_KERNEL_IDIOM_H
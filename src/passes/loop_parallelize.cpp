@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <climits>
+#include <set>
+#include <vector>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/Analysis/DependenceAnalysis.h>
+#include <llvm/Analysis/IVDescriptors.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/LoopUtils.h>
+#include <llvm/Transforms/Utils/ScalarEvolutionExpander.h>
+#include "log.h"
+#include "loop_parallelize.h"
+#include "loop_utils.h"
+
+using namespace llvm;
+
+// 与runtime_lib/sylib.h中的_SYSY_MAX_THREADS一致，即每个归约在ctx中的槽位数
+static constexpr unsigned maxThreads = 16;
+
+// 一次并行执行（唤醒线程池、等待所有线程完成）的开销折合的指令数，迭代次数×循环体大小低于它时串行执行
+static constexpr uint64_t forkJoinCost = 1 << 17;
+
+// 估算循环体大小时，子循环中的指令按每层64次迭代计，最多计3层
+static constexpr unsigned subloopWeightShift = 6;
+static constexpr unsigned maxSubloopDepth = 3;
+
+// 依赖分析需要两两比较内存访问，访问过多的循环不处理
+static constexpr size_t maxAccesses = 64;
+
+// 标记工作函数，其中的循环不再并行化（线程池不支持嵌套）
+static const char *const workerAttribute = "sysy-parallel-worker";
+
+namespace {
+    struct Reduction {
+        PHINode *phi;
+        RecurrenceDescriptor descriptor;
+    };
+
+    // 可以并行化的循环
+    struct Candidate {
+        Loop *loop = nullptr;
+        BasicBlock *exit = nullptr;
+        const SCEV *backedgeTakenCount = nullptr;
+        std::vector<Induction> inductions;
+        std::vector<Reduction> reductions;
+        // 循环中使用的外部值，依次存放在ctx结构体中，之后是各归约的线程槽位
+        SetVector<Value *> liveIns;
+        uint64_t threshold = 0;
+    };
+}
+
+static bool isSupportedReduction(RecurKind kind) {
+    switch (kind) {
+        case RecurKind::Add:
+        case RecurKind::Mul:
+        case RecurKind::Or:
+        case RecurKind::And:
+        case RecurKind::Xor:
+        case RecurKind::SMin:
+        case RecurKind::SMax:
+        case RecurKind::UMin:
+        case RecurKind::UMax:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static Value *combine(IRBuilder<> &builder, RecurKind kind, Value *lhs, Value *rhs) {
+    if (RecurrenceDescriptor::isMinMaxRecurrenceKind(kind)) {
+        return createMinMaxOp(builder, kind, lhs, rhs);
+    }
+    return builder.CreateBinOp(static_cast<Instruction::BinaryOps>(RecurrenceDescriptor::getOpcode(kind)), lhs, rhs);
+}
+
+static Value *identityOf(const Reduction &reduction) {
+    return reduction.descriptor.getRecurrenceIdentity(
+            reduction.descriptor.getRecurrenceKind(),
+            reduction.phi->getType(),
+            FastMathFlags()
+    );
+}
+
+// 头部的phi只能是步长为常量的整数归纳变量或支持的归约
+static bool classifyPhis(Loop *L, ScalarEvolution &SE, Candidate &candidate) {
+    for (PHINode &phi: L->getHeader()->phis()) {
+        if (!phi.getType()->isIntegerTy()) {
+            return false;
+        }
+        InductionDescriptor induction;
+        if (isConstantStepInduction(phi, L, SE, induction)) {
+            candidate.inductions.push_back({&phi, induction});
+            continue;
+        }
+        RecurrenceDescriptor reduction;
+        if (RecurrenceDescriptor::isReductionPHI(&phi, L, reduction) &&
+            isSupportedReduction(reduction.getRecurrenceKind())) {
+            candidate.reductions.push_back({&phi, reduction});
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// 至少一方为store的每对访问，在本层循环上的方向都必须是=（只在同一次迭代内相关）
+static bool hasCarriedDependence(Loop *L, DependenceInfo &DI, const std::vector<Instruction *> &accesses) {
+    unsigned level = L->getLoopDepth();
+    for (size_t i = 0; i < accesses.size(); i++) {
+        for (size_t j = i; j < accesses.size(); j++) {
+            Instruction *src = accesses[i], *dst = accesses[j];
+            if (!llvm::isa<StoreInst>(src) && !llvm::isa<StoreInst>(dst)) {
+                continue;
+            }
+            auto dependence = DI.depends(src, dst, true);
+            if (!dependence) {
+                continue;
+            }
+            if (dependence->isConfused() || level > dependence->getLevels() ||
+                dependence->getDirection(level) != Dependence::DVEntry::EQ) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 循环中的值只有归约的结果可以在循环外使用（通过退出块中的LCSSA phi）
+static bool checkLiveOuts(const Candidate &candidate) {
+    std::set<const Instruction *> results;
+    for (const Reduction &reduction: candidate.reductions) {
+        results.insert(reduction.descriptor.getLoopExitInstr());
+    }
+    for (BasicBlock *BB: candidate.loop->blocks()) {
+        for (Instruction &I: *BB) {
+            for (User *user: I.users()) {
+                auto *userInst = llvm::cast<Instruction>(user);
+                if (candidate.loop->contains(userInst)) {
+                    continue;
+                }
+                if (!llvm::isa<PHINode>(userInst) || userInst->getParent() != candidate.exit || !results.count(&I)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// 头部phi的初值在工作函数中单独计算，归纳变量的初值仍需传入
+static void collectLiveIns(Candidate &candidate) {
+    Loop *L = candidate.loop;
+    BasicBlock *preheader = L->getLoopPreheader();
+    auto add = [&](Value *value) {
+        auto *inst = llvm::dyn_cast<Instruction>(value);
+        if (llvm::isa<Argument>(value) || (inst && !L->contains(inst))) {
+            candidate.liveIns.insert(value);
+        }
+    };
+    for (BasicBlock *BB: L->blocks()) {
+        for (Instruction &I: *BB) {
+            auto *phi = llvm::dyn_cast<PHINode>(&I);
+            for (Use &operand: I.operands()) {
+                if (!phi || phi->getIncomingBlock(operand) != preheader) {
+                    add(operand.get());
+                }
+            }
+        }
+    }
+    for (const Induction &induction: candidate.inductions) {
+        add(induction.descriptor.getStartValue());
+    }
+}
+
+// 循环体大小，子循环中的指令按迭代次数加权
+static uint64_t estimateBodySize(Loop *L, LoopInfo &LI) {
+    uint64_t size = 0;
+    for (BasicBlock *BB: L->blocks()) {
+        unsigned depth = std::min(LI.getLoopDepth(BB) - L->getLoopDepth(), maxSubloopDepth);
+        size += static_cast<uint64_t>(BB->size()) << (subloopWeightShift * depth);
+    }
+    return std::max<uint64_t>(size, 1);
+}
+
+// 检查循环能否并行化，不能时返回原因
+static const char *analyze(
+        Loop *L,
+        LoopInfo &LI,
+        ScalarEvolution &SE,
+        DependenceInfo &DI,
+        Candidate &candidate
+) {
+    if (!isCanonicalLoop(L)) {
+        return "not in canonical form";
+    }
+    candidate.loop = L;
+    candidate.exit = L->getExitBlock();
+
+    candidate.backedgeTakenCount = SE.getBackedgeTakenCount(L);
+    if (llvm::isa<SCEVCouldNotCompute>(candidate.backedgeTakenCount) ||
+        !isSafeToExpand(candidate.backedgeTakenCount, SE)) {
+        return "unknown trip count";
+    }
+
+    std::vector<Instruction *> accesses;
+    if (!collectMemoryAccesses(L, accesses)) {
+        return "calls, allocas or atomic accesses";
+    }
+    if (!classifyPhis(L, SE, candidate)) {
+        return "recurrence other than integer reduction";
+    }
+    if (!checkLiveOuts(candidate)) {
+        return "values other than reductions used after the loop";
+    }
+    if (accesses.size() > maxAccesses) {
+        return "too many memory accesses";
+    }
+    if (hasCarriedDependence(L, DI, accesses)) {
+        return "loop-carried dependence";
+    }
+
+    collectLiveIns(candidate);
+    uint64_t size = estimateBodySize(L, LI);
+    candidate.threshold = std::max<uint64_t>((forkJoinCost + size - 1) / size, 2);
+    return nullptr;
+}
+
+// 工作函数f.parallel(lo, hi, thread, ctx)：执行第[lo, hi)次迭代，归约结果合并到第thread个槽位
+static Function *createWorker(Function &F, const Candidate &candidate, StructType *ctxTy) {
+    Module &M = *F.getParent();
+    LLVMContext &ctx = F.getContext();
+    Loop *L = candidate.loop;
+    // 克隆出的跳转指令在重映射之前仍指向原循环头，此时getLoopPreheader()找不到唯一的preheader
+    BasicBlock *preheader = L->getLoopPreheader();
+    Type *int32Ty = Type::getInt32Ty(ctx);
+
+    auto *workerTy = FunctionType::get(
+            Type::getVoidTy(ctx),
+            {int32Ty, int32Ty, int32Ty, Type::getInt8PtrTy(ctx)},
+            false
+    );
+    Function *worker = Function::Create(workerTy, GlobalValue::InternalLinkage, F.getName() + ".parallel", M);
+    worker->addFnAttr(Attribute::NoUnwind);
+    worker->addFnAttr(workerAttribute);
+    Argument *lo = worker->getArg(0), *hi = worker->getArg(1), *thread = worker->getArg(2);
+    lo->setName("lo");
+    hi->setName("hi");
+    thread->setName("thread");
+    worker->getArg(3)->setName("ctx");
+
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", worker);
+    IRBuilder<> builder(entry);
+    Value *ctxPtr = builder.CreateBitCast(worker->getArg(3), ctxTy->getPointerTo());
+    ValueToValueMapTy map;
+    for (unsigned i = 0; i < candidate.liveIns.size(); i++) {
+        Value *value = candidate.liveIns[i];
+        map[value] = builder.CreateLoad(value->getType(), builder.CreateStructGEP(ctxTy, ctxPtr, i), value->getName());
+    }
+
+    // 第k次迭代时归纳变量的值为start + k * step，从第lo次迭代开始
+    std::vector<Value *> starts;
+    for (const Induction &induction: candidate.inductions) {
+        Value *start = induction.descriptor.getStartValue();
+        if (Value *mapped = map.lookup(start)) {
+            start = mapped;
+        }
+        Value *offset = builder.CreateMul(
+                builder.CreateSExtOrTrunc(lo, induction.phi->getType()),
+                induction.descriptor.getConstIntStepValue()
+        );
+        starts.emplace_back(builder.CreateAdd(start, offset, induction.phi->getName() + ".start"));
+    }
+
+    SmallVector<BasicBlock *, 16> clones;
+    for (BasicBlock *BB: L->blocks()) {
+        BasicBlock *clone = CloneBasicBlock(BB, map, "", worker);
+        map[BB] = clone;
+        clones.emplace_back(clone);
+    }
+    BasicBlock *exit = BasicBlock::Create(ctx, "exit", worker);
+    map[preheader] = entry;
+    map[candidate.exit] = exit;
+    remapInstructionsInBlocks(clones, map);
+
+    auto *header = llvm::cast<BasicBlock>(map[L->getHeader()]);
+    auto *latch = llvm::cast<BasicBlock>(map[L->getLoopLatch()]);
+    for (unsigned i = 0; i < candidate.inductions.size(); i++) {
+        llvm::cast<PHINode>(map[candidate.inductions[i].phi])->setIncomingValueForBlock(entry, starts[i]);
+    }
+    for (const Reduction &reduction: candidate.reductions) {
+        llvm::cast<PHINode>(map[reduction.phi])->setIncomingValueForBlock(entry, identityOf(reduction));
+    }
+    builder.CreateBr(header);
+
+    // 用迭代计数代替原来的退出条件
+    builder.SetInsertPoint(&header->front());
+    PHINode *k = builder.CreatePHI(int32Ty, 2, "k");
+    latch->getTerminator()->eraseFromParent();
+    builder.SetInsertPoint(latch);
+    Value *next = builder.CreateAdd(k, builder.getInt32(1), "k.next");
+    k->addIncoming(lo, entry);
+    k->addIncoming(next, latch);
+    builder.CreateCondBr(builder.CreateICmpSLT(next, hi), header, exit);
+
+    builder.SetInsertPoint(exit);
+    for (unsigned i = 0; i < candidate.reductions.size(); i++) {
+        const Reduction &reduction = candidate.reductions[i];
+        Value *slot = builder.CreateInBoundsGEP(ctxTy, ctxPtr, {
+                builder.getInt32(0),
+                builder.getInt32(candidate.liveIns.size() + i),
+                thread
+        });
+        Value *partial = builder.CreateLoad(reduction.phi->getType(), slot);
+        Value *result = map[reduction.descriptor.getLoopExitInstr()];
+        builder.CreateStore(combine(builder, reduction.descriptor.getRecurrenceKind(), partial, result), slot);
+    }
+    builder.CreateRetVoid();
+    return worker;
+}
+
+// 在preheader中按迭代次数选择调用_sysy_parallel_for或执行原循环，原循环保留作为串行版本
+static void parallelize(Function &F, const Candidate &candidate, Value *count) {
+    Module &M = *F.getParent();
+    LLVMContext &ctx = F.getContext();
+    Loop *L = candidate.loop;
+    BasicBlock *preheader = L->getLoopPreheader();
+    BasicBlock *latch = L->getLoopLatch();
+    Type *int32Ty = Type::getInt32Ty(ctx);
+
+    std::vector<Type *> fields;
+    for (Value *value: candidate.liveIns) {
+        fields.emplace_back(value->getType());
+    }
+    for (const Reduction &reduction: candidate.reductions) {
+        fields.emplace_back(ArrayType::get(reduction.phi->getType(), maxThreads));
+    }
+    StructType *ctxTy = StructType::get(ctx, fields);
+    Function *worker = createWorker(F, candidate, ctxTy);
+
+    // 迭代次数在[threshold, INT_MAX]内时并行执行；回边次数为全1时迭代次数回绕为0
+    IRBuilder<> builder(preheader->getTerminator());
+    auto *countTy = llvm::cast<IntegerType>(count->getType());
+    Value *enough = builder.CreateICmpUGE(count, ConstantInt::get(countTy, candidate.threshold));
+    if (countTy->getBitWidth() >= 32) {
+        enough = builder.CreateAnd(enough, builder.CreateICmpULE(count, ConstantInt::get(countTy, INT_MAX)));
+    }
+    BasicBlock *parallel = BasicBlock::Create(ctx, "parallel", &F, L->getHeader());
+    preheader->getTerminator()->eraseFromParent();
+    builder.SetInsertPoint(preheader);
+    builder.CreateCondBr(enough, parallel, L->getHeader());
+
+    builder.SetInsertPoint(parallel);
+    auto *ctxAlloca = new AllocaInst(
+            ctxTy,
+            M.getDataLayout().getAllocaAddrSpace(),
+            "parallel.ctx",
+            &*F.getEntryBlock().getFirstInsertionPt()
+    );
+    for (unsigned i = 0; i < candidate.liveIns.size(); i++) {
+        builder.CreateStore(candidate.liveIns[i], builder.CreateStructGEP(ctxTy, ctxAlloca, i));
+    }
+    auto slot = [&](unsigned reduction, unsigned thread) {
+        return builder.CreateInBoundsGEP(ctxTy, ctxAlloca, {
+                builder.getInt32(0),
+                builder.getInt32(candidate.liveIns.size() + reduction),
+                builder.getInt32(thread)
+        });
+    };
+    for (unsigned i = 0; i < candidate.reductions.size(); i++) {
+        for (unsigned thread = 0; thread < maxThreads; thread++) {
+            builder.CreateStore(identityOf(candidate.reductions[i]), slot(i, thread));
+        }
+    }
+
+    FunctionCallee parallelFor = M.getOrInsertFunction(
+            "_sysy_parallel_for",
+            FunctionType::get(
+                    Type::getVoidTy(ctx),
+                    {int32Ty, int32Ty, worker->getType(), Type::getInt8PtrTy(ctx)},
+                    false
+            )
+    );
+    if (auto *declaration = llvm::dyn_cast<Function>(parallelFor.getCallee())) {
+        declaration->addFnAttr(Attribute::NoUnwind);
+    }
+    builder.CreateCall(parallelFor, {
+            builder.getInt32(0),
+            builder.CreateZExtOrTrunc(count, int32Ty),
+            worker,
+            builder.CreateBitCast(ctxAlloca, Type::getInt8PtrTy(ctx))
+    });
+
+    // 初值依次与各线程的部分结果合并
+    std::vector<Value *> results;
+    for (unsigned i = 0; i < candidate.reductions.size(); i++) {
+        const Reduction &reduction = candidate.reductions[i];
+        Value *result = reduction.descriptor.getRecurrenceStartValue();
+        for (unsigned thread = 0; thread < maxThreads; thread++) {
+            Value *partial = builder.CreateLoad(reduction.phi->getType(), slot(i, thread));
+            result = combine(builder, reduction.descriptor.getRecurrenceKind(), result, partial);
+        }
+        results.emplace_back(result);
+    }
+    builder.CreateBr(candidate.exit);
+
+    for (PHINode &phi: candidate.exit->phis()) {
+        Value *value = phi.getIncomingValueForBlock(latch);
+        for (unsigned i = 0; i < candidate.reductions.size(); i++) {
+            if (value == candidate.reductions[i].descriptor.getLoopExitInstr()) {
+                value = results[i];
+            }
+        }
+        phi.addIncoming(value, parallel);
+    }
+}
+
+PreservedAnalyses LoopParallelizePass::run(Function &F, FunctionAnalysisManager &AM) {
+    // 只读内存的函数可能在并行循环中被调用，与工作函数一样，其中的循环不能再并行化
+    if (F.hasFnAttribute(workerAttribute) || F.onlyReadsMemory()) {
+        return PreservedAnalyses::all();
+    }
+
+    LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+    ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    DependenceInfo &DI = AM.getResult<DependenceAnalysis>(F);
+
+    // 从最外层开始，不能并行化时尝试子循环
+    std::vector<Candidate> candidates;
+    std::vector<Loop *> worklist(LI.begin(), LI.end());
+    while (!worklist.empty()) {
+        Loop *L = worklist.back();
+        worklist.pop_back();
+        Candidate candidate;
+        if (const char *reason = analyze(L, LI, SE, DI, candidate)) {
+            log("parallel") << F.getName().str() << ": loop " << L->getHeader()->getName().str()
+                            << " not parallelized: " << reason << std::endl;
+            worklist.insert(worklist.end(), L->begin(), L->end());
+            continue;
+        }
+        candidates.emplace_back(std::move(candidate));
+    }
+    if (candidates.empty()) {
+        return PreservedAnalyses::all();
+    }
+
+    // 修改控制流之前展开所有迭代次数
+    std::vector<Value *> counts;
+    SCEVExpander expander(SE, F.getParent()->getDataLayout(), "parallel");
+    for (const Candidate &candidate: candidates) {
+        Instruction *insertPoint = candidate.loop->getLoopPreheader()->getTerminator();
+        Value *backedgeTaken = expander.expandCodeFor(candidate.backedgeTakenCount, nullptr, insertPoint);
+        counts.emplace_back(BinaryOperator::CreateAdd(
+                backedgeTaken,
+                ConstantInt::get(backedgeTaken->getType(), 1),
+                "parallel.count",
+                insertPoint
+        ));
+    }
+
+    for (unsigned i = 0; i < candidates.size(); i++) {
+        log("parallel") << F.getName().str() << ": loop " << candidates[i].loop->getHeader()->getName().str()
+                        << " parallelized, " << candidates[i].reductions.size() << " reductions, threshold "
+                        << candidates[i].threshold << " iterations" << std::endl;
+        parallelize(F, candidates[i], counts[i]);
+    }
+    return PreservedAnalyses::none();
+}
@@ -0,0 +1,20 @@
+#ifndef SYSY_COMPILER_PASSES_LOOP_PARALLELIZE_H
+#define SYSY_COMPILER_PASSES_LOOP_PARALLELIZE_H
+
+#include <llvm/IR/PassManager.h>
+
+// 循环自动并行化（--parallel开启）
+// 对迭代之间没有依赖的循环（DOALL），将循环提取为工作函数f.parallel(lo, hi, thread, ctx)，执行第[lo, hi)次迭代，
+// 循环使用的外部值通过ctx结构体传入；运行时库的_sysy_parallel_for把迭代均分给线程池中的线程执行
+// 条件（从外层循环开始尝试，外层不满足时再尝试内层）：
+// 1. 规范形式（有preheader，latch是唯一的退出块），SCEV可以计算迭代次数
+// 2. 没有alloca与访问内存的函数调用，DependenceAnalysis证明任意两次不同迭代的内存访问不冲突
+// 3. 头部的phi为整数归纳变量或int的加、乘、位运算、min/max归约，其他值不在循环外使用
+//    各线程的归约结果写入ctx中按线程编号的槽位，join后与初值合并
+// 迭代次数低于按循环体大小估算的阈值时，执行原来的串行循环
+class LoopParallelizePass : public llvm::PassInfoMixin<LoopParallelizePass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+#endif //SYSY_COMPILER_PASSES_LOOP_PARALLELIZE_H
@@ -0,0 +1,284 @@
+#include <climits>
+#include <vector>
+#include <llvm/Analysis/DependenceAnalysis.h>
+#include <llvm/Analysis/IVDescriptors.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/ScalarEvolutionExpander.h>
+#include "log.h"
+#include "loop_tiling.h"
+#include "loop_utils.h"
+
+using namespace llvm;
+
+// 缓存行大小（字节），L1相邻迭代之间地址相差小于它的访问可以复用缓存行
+static constexpr int64_t cacheLineSize = 64;
+
+// 依赖分析需要两两比较内存访问，访问过多的循环嵌套不处理
+static constexpr size_t maxAccesses = 64;
+
+namespace {
+    // 可以分块的两层循环
+    struct Candidate {
+        Loop *outer = nullptr;
+        Loop *inner = nullptr;
+        const SCEV *innerBackedgeTakenCount = nullptr;
+        std::vector<Induction> innerInductions;
+    };
+}
+
+// 退出块中没有LCSSA phi（循环中的值不在循环外使用）
+static bool hasNoLiveOuts(Loop *L) {
+    return L->getExitBlock()->phis().empty();
+}
+
+// 外层循环中内层循环之外的部分在每块中都会重新执行，不能访问内存或有其他副作用
+static bool hasSideEffectsOutside(Loop *outer, Loop *inner) {
+    for (BasicBlock *BB: outer->blocks()) {
+        if (inner->contains(BB)) {
+            continue;
+        }
+        for (Instruction &I: *BB) {
+            if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 分块相当于交换块循环与外层循环，存在外层方向与内层方向相反的依赖时不合法
+static bool hasReversedDependence(Loop *outer, Loop *inner, DependenceInfo &DI, const std::vector<Instruction *> &accesses) {
+    unsigned outerLevel = outer->getLoopDepth(), innerLevel = inner->getLoopDepth();
+    for (size_t i = 0; i < accesses.size(); i++) {
+        for (size_t j = i; j < accesses.size(); j++) {
+            Instruction *src = accesses[i], *dst = accesses[j];
+            if (!llvm::isa<StoreInst>(src) && !llvm::isa<StoreInst>(dst)) {
+                continue;
+            }
+            auto dependence = DI.depends(src, dst, true);
+            if (!dependence) {
+                continue;
+            }
+            if (dependence->isConfused() || innerLevel > dependence->getLevels()) {
+                return true;
+            }
+            unsigned outerDirection = dependence->getDirection(outerLevel);
+            unsigned innerDirection = dependence->getDirection(innerLevel);
+            if (((outerDirection & Dependence::DVEntry::LT) && (innerDirection & Dependence::DVEntry::GT)) ||
+                ((outerDirection & Dependence::DVEntry::GT) && (innerDirection & Dependence::DVEntry::LT))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 地址在外层循环相邻迭代之间的变化量（字节），不是常量时返回false
+static bool getOuterStride(const SCEV *address, Loop *outer, ScalarEvolution &SE, int64_t &stride) {
+    while (auto *addRec = llvm::dyn_cast<SCEVAddRecExpr>(address)) {
+        if (addRec->getLoop() == outer) {
+            auto *step = llvm::dyn_cast<SCEVConstant>(addRec->getStepRecurrence(SE));
+            if (!step) {
+                return false;
+            }
+            stride = step->getAPInt().getSExtValue();
+            return true;
+        }
+        address = addRec->getStart();
+    }
+    stride = 0;
+    return SE.isLoopInvariant(address, outer);
+}
+
+// 存在跨外层迭代复用（外层步长小于缓存行）、且随内层循环变化的访问时，分块才有收益
+static bool hasReuseAcrossOuter(Loop *outer, Loop *inner, ScalarEvolution &SE, const std::vector<Instruction *> &accesses) {
+    for (Instruction *I: accesses) {
+        const SCEV *address = SE.getSCEV(getLoadStorePointerOperand(I));
+        int64_t stride;
+        if (!SE.isLoopInvariant(address, inner) &&
+            getOuterStride(address, outer, SE, stride) &&
+            stride > -cacheLineSize && stride < cacheLineSize) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 检查两层循环能否分块，不能时返回原因
+static const char *analyze(
+        Loop *outer,
+        Loop *inner,
+        unsigned tileSize,
+        ScalarEvolution &SE,
+        DependenceInfo &DI,
+        Candidate &candidate
+) {
+    if (!isCanonicalLoop(outer) || !isCanonicalLoop(inner) || !hasNoLiveOuts(outer) || !hasNoLiveOuts(inner)) {
+        return "not in canonical form";
+    }
+    std::vector<Induction> outerInductions;
+    if (!collectInductions(outer, SE, outerInductions) ||
+        !collectInductions(inner, SE, candidate.innerInductions)) {
+        return "recurrence other than induction";
+    }
+
+    candidate.innerBackedgeTakenCount = SE.getBackedgeTakenCount(inner);
+    if (llvm::isa<SCEVCouldNotCompute>(candidate.innerBackedgeTakenCount) ||
+        candidate.innerBackedgeTakenCount->getType()->getIntegerBitWidth() < 32 ||
+        !SE.isLoopInvariant(candidate.innerBackedgeTakenCount, outer) ||
+        !isSafeToExpand(candidate.innerBackedgeTakenCount, SE)) {
+        return "inner trip count unknown or depends on the outer loop";
+    }
+    auto *constant = llvm::dyn_cast<SCEVConstant>(candidate.innerBackedgeTakenCount);
+    if (constant && constant->getAPInt().ult(tileSize)) {
+        return "inner trip count not larger than the tile size";
+    }
+
+    if (hasSideEffectsOutside(outer, inner)) {
+        return "memory accesses outside the inner loop";
+    }
+    std::vector<Instruction *> accesses;
+    if (!collectMemoryAccesses(inner, accesses)) {
+        return "calls, allocas or atomic accesses";
+    }
+    if (accesses.size() > maxAccesses) {
+        return "too many memory accesses";
+    }
+    if (!hasReuseAcrossOuter(outer, inner, SE, accesses)) {
+        return "no reuse across outer iterations";
+    }
+    if (hasReversedDependence(outer, inner, DI, accesses)) {
+        return "dependence prevents tiling";
+    }
+
+    candidate.outer = outer;
+    candidate.inner = inner;
+    return nullptr;
+}
+
+// count为内层循环的迭代次数，在[1, INT_MAX]之外时（内层循环不执行或迭代次数回绕）只执行一块且不限制块内迭代次数
+static void tile(const Candidate &candidate, Value *count, unsigned tileSize) {
+    Loop *outer = candidate.outer, *inner = candidate.inner;
+    BasicBlock *outerPreheader = outer->getLoopPreheader();
+    BasicBlock *outerHeader = outer->getHeader();
+    BasicBlock *outerLatch = outer->getLoopLatch();
+    BasicBlock *outerExit = outer->getExitBlock();
+    BasicBlock *innerPreheader = inner->getLoopPreheader();
+    BasicBlock *innerHeader = inner->getHeader();
+    BasicBlock *innerLatch = inner->getLoopLatch();
+    Function &F = *outerHeader->getParent();
+    LLVMContext &ctx = F.getContext();
+    auto *countTy = llvm::cast<IntegerType>(count->getType());
+
+    IRBuilder<> builder(outerPreheader->getTerminator());
+    Value *tiled = builder.CreateICmpULT(
+            builder.CreateSub(count, ConstantInt::get(countTy, 1)),
+            ConstantInt::get(countTy, INT_MAX),
+            "tile.enabled"
+    );
+    Value *tileSizeValue = ConstantInt::get(countTy, tileSize);
+    Value *limit = builder.CreateSelect(tiled, tileSizeValue, ConstantInt::get(countTy, 0), "tile.limit");
+
+    // 块循环：jj = 0, N, 2N, ...，包住整个外层循环
+    BasicBlock *tileHeader = BasicBlock::Create(ctx, "tile.header", &F, outerHeader);
+    BasicBlock *tileLatch = BasicBlock::Create(ctx, "tile.latch", &F, outerExit);
+    outerPreheader->getTerminator()->replaceSuccessorWith(outerHeader, tileHeader);
+    for (PHINode &phi: outerHeader->phis()) {
+        phi.replaceIncomingBlockWith(outerPreheader, tileHeader);
+    }
+    outerLatch->getTerminator()->replaceSuccessorWith(outerExit, tileLatch);
+
+    builder.SetInsertPoint(tileHeader);
+    PHINode *tileStart = builder.CreatePHI(countTy, 2, "jj");
+    builder.CreateBr(outerHeader);
+
+    builder.SetInsertPoint(tileLatch);
+    Value *nextTile = builder.CreateAdd(tileStart, tileSizeValue, "jj.next");
+    tileStart->addIncoming(ConstantInt::get(countTy, 0), outerPreheader);
+    tileStart->addIncoming(nextTile, tileLatch);
+    builder.CreateCondBr(
+            builder.CreateAnd(tiled, builder.CreateICmpULT(nextTile, count)),
+            tileHeader,
+            outerExit
+    );
+
+    // 内层循环从第jj次迭代开始
+    builder.SetInsertPoint(innerPreheader->getTerminator());
+    for (const Induction &induction: candidate.innerInductions) {
+        Value *start = induction.phi->getIncomingValueForBlock(innerPreheader);
+        Value *offset = builder.CreateMul(
+                builder.CreateSExtOrTrunc(tileStart, induction.phi->getType()),
+                induction.descriptor.getConstIntStepValue()
+        );
+        induction.phi->setIncomingValueForBlock(
+                innerPreheader,
+                builder.CreateAdd(start, offset, induction.phi->getName() + ".tile")
+        );
+    }
+
+    // 每块执行N次迭代后退出
+    builder.SetInsertPoint(&innerHeader->front());
+    PHINode *k = builder.CreatePHI(countTy, 2, "tile.k");
+    auto *branch = llvm::cast<BranchInst>(innerLatch->getTerminator());
+    builder.SetInsertPoint(branch);
+    Value *nextK = builder.CreateAdd(k, ConstantInt::get(countTy, 1), "tile.k.next");
+    k->addIncoming(ConstantInt::get(countTy, 0), innerPreheader);
+    k->addIncoming(nextK, innerLatch);
+    Value *tileEnd = builder.CreateICmpEQ(nextK, limit, "tile.end");
+    if (branch->getSuccessor(0) == innerHeader) {
+        branch->setCondition(builder.CreateAnd(branch->getCondition(), builder.CreateNot(tileEnd)));
+    } else {
+        branch->setCondition(builder.CreateOr(branch->getCondition(), tileEnd));
+    }
+}
+
+PreservedAnalyses LoopTilingPass::run(Function &F, FunctionAnalysisManager &AM) {
+    LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+    ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    DependenceInfo &DI = AM.getResult<DependenceAnalysis>(F);
+
+    // 先序遍历，外层的两层循环先分块；一个循环可以同时是一对的内层与另一对的外层（如3层嵌套的两次分块）
+    std::vector<Candidate> candidates;
+    for (Loop *L: LI.getLoopsInPreorder()) {
+        if (L->getSubLoops().size() != 1) {
+            continue;
+        }
+        Candidate candidate;
+        Loop *inner = L->getSubLoops().front();
+        if (const char *reason = analyze(L, inner, tileSize, SE, DI, candidate)) {
+            log("tiling") << F.getName().str() << ": loops " << L->getHeader()->getName().str() << ", "
+                          << inner->getHeader()->getName().str() << " not tiled: " << reason << std::endl;
+            continue;
+        }
+        candidates.emplace_back(std::move(candidate));
+    }
+    if (candidates.empty()) {
+        return PreservedAnalyses::all();
+    }
+
+    // 修改控制流之前展开所有迭代次数
+    std::vector<Value *> counts;
+    SCEVExpander expander(SE, F.getParent()->getDataLayout(), "tile");
+    for (const Candidate &candidate: candidates) {
+        Instruction *insertPoint = candidate.outer->getLoopPreheader()->getTerminator();
+        Value *backedgeTaken = expander.expandCodeFor(candidate.innerBackedgeTakenCount, nullptr, insertPoint);
+        counts.emplace_back(BinaryOperator::CreateAdd(
+                backedgeTaken,
+                ConstantInt::get(backedgeTaken->getType(), 1),
+                "tile.count",
+                insertPoint
+        ));
+    }
+
+    for (unsigned i = 0; i < candidates.size(); i++) {
+        log("tiling") << F.getName().str() << ": loops " << candidates[i].outer->getHeader()->getName().str() << ", "
+                      << candidates[i].inner->getHeader()->getName().str() << " tiled" << std::endl;
+        tile(candidates[i], counts[i], tileSize);
+    }
+    return PreservedAnalyses::none();
+}
@@ -0,0 +1,26 @@
+#ifndef SYSY_COMPILER_PASSES_LOOP_TILING_H
+#define SYSY_COMPILER_PASSES_LOOP_TILING_H
+
+#include <llvm/IR/PassManager.h>
+
+// 循环分块（--tile-size=N指定块大小，0关闭）
+// 对两层嵌套的循环L1（外层）与L2（L1中唯一的子循环，其中可以再有子循环），把L2的迭代按块大小切分，
+// 块循环移到L1之外：for i: for j → for jj: for i: for j in [jj, jj + N)
+// 适用于L2中有访问在L1的相邻迭代之间地址不变或相邻（跨L1复用），但随L2（或更内层的循环）变化的情况，
+// 例如转置b[j][i] = a[i][j]、朴素矩阵乘法中的b[k][j]，分块后一块数据在L1的各次迭代之间留在缓存中
+// 条件：
+// 1. 两层循环都是规范形式，头部phi只有整数归纳变量，L2的迭代次数与L1无关，循环中的值不在循环外使用
+// 2. L1中L2之外的部分不访问内存（每块都会重新执行一次）
+// 3. 依赖分析证明不存在L1与L2方向相反的依赖（交换块循环与L1合法）
+// 块循环从L2的第0次迭代开始，每块在L2原来的退出条件之外，再在执行N次迭代后退出
+class LoopTilingPass : public llvm::PassInfoMixin<LoopTilingPass> {
+public:
+    explicit LoopTilingPass(unsigned tileSize) : tileSize(tileSize) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+
+private:
+    unsigned tileSize;
+};
+
+#endif //SYSY_COMPILER_PASSES_LOOP_TILING_H
@@ -0,0 +1,54 @@
+#include <llvm/IR/Instructions.h>
+#include "loop_utils.h"
+
+using namespace llvm;
+
+bool isCanonicalLoop(Loop *L) {
+    BasicBlock *latch = L->getLoopLatch();
+    if (!L->isLoopSimplifyForm() || L->getExitingBlock() != latch || !L->getExitBlock()) {
+        return false;
+    }
+    auto *branch = llvm::dyn_cast<BranchInst>(latch->getTerminator());
+    return branch && branch->isConditional();
+}
+
+bool isConstantStepInduction(PHINode &phi, Loop *L, ScalarEvolution &SE, InductionDescriptor &descriptor) {
+    return phi.getType()->isIntegerTy() &&
+           InductionDescriptor::isInductionPHI(&phi, L, &SE, descriptor) &&
+           descriptor.getConstIntStepValue();
+}
+
+bool collectInductions(Loop *L, ScalarEvolution &SE, std::vector<Induction> &inductions) {
+    for (PHINode &phi: L->getHeader()->phis()) {
+        InductionDescriptor induction;
+        if (!isConstantStepInduction(phi, L, SE, induction)) {
+            return false;
+        }
+        inductions.push_back({&phi, induction});
+    }
+    return true;
+}
+
+bool collectMemoryAccesses(Loop *L, std::vector<Instruction *> &accesses) {
+    for (BasicBlock *BB: L->blocks()) {
+        for (Instruction &I: *BB) {
+            if (llvm::isa<AllocaInst>(I)) {
+                return false;
+            }
+            if (auto *CB = llvm::dyn_cast<CallBase>(&I)) {
+                if (!CB->doesNotAccessMemory()) {
+                    return false;
+                }
+                continue;
+            }
+            auto *load = llvm::dyn_cast<LoadInst>(&I);
+            auto *store = llvm::dyn_cast<StoreInst>(&I);
+            if ((load && load->isSimple()) || (store && store->isSimple())) {
+                accesses.emplace_back(&I);
+            } else if (I.mayReadOrWriteMemory()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef SYSY_COMPILER_PASSES_LOOP_UTILS_H
+#define SYSY_COMPILER_PASSES_LOOP_UTILS_H
+
+#include <vector>
+#include <llvm/Analysis/IVDescriptors.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+
+// 循环变换（并行化、分块、内核替换）共用的循环形状与内存访问检查
+
+struct Induction {
+    llvm::PHINode *phi;
+    llvm::InductionDescriptor descriptor;
+};
+
+// 规范形式：有preheader，latch是唯一的退出块且以条件跳转结束，有唯一的退出块
+bool isCanonicalLoop(llvm::Loop *L);
+
+// phi是步长为常量的整数归纳变量时返回true，描述符通过descriptor返回
+bool isConstantStepInduction(llvm::PHINode &phi, llvm::Loop *L, llvm::ScalarEvolution &SE,
+                             llvm::InductionDescriptor &descriptor);
+
+// 头部的phi只能是步长为常量的整数归纳变量
+bool collectInductions(llvm::Loop *L, llvm::ScalarEvolution &SE, std::vector<Induction> &inductions);
+
+// 收集循环中的load/store，存在其他访问内存的指令（alloca、访问内存的调用、原子或volatile访问）时返回false
+bool collectMemoryAccesses(llvm::Loop *L, std::vector<llvm::Instruction *> &accesses);
+
+#endif //SYSY_COMPILER_PASSES_LOOP_UTILS_H
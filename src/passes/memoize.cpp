@@ -0,0 +1,188 @@
+#include <set>
+#include <vector>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include "log.h"
+#include "memoize.h"
+
+using namespace llvm;
+
+// 缓存表的项数，必须是2的幂
+static constexpr unsigned tableSize = 1 << 14;
+
+// 作为键的参数个数上限，参数越多，比较键的开销越大、命中率越低
+static constexpr unsigned maxArguments = 3;
+
+// 函数级内存属性，记忆化后函数会读写缓存表，这些属性不再成立
+static const Attribute::AttrKind memoryAttributes[] = {
+        Attribute::ReadNone,
+        Attribute::ReadOnly,
+        Attribute::WriteOnly,
+        Attribute::ArgMemOnly,
+        Attribute::InaccessibleMemOnly,
+        Attribute::InaccessibleMemOrArgMemOnly,
+};
+
+static bool isCandidate(Function &F, FunctionAnalysisManager &FAM) {
+    if (F.isDeclaration() || !F.hasLocalLinkage() || !F.doesNotAccessMemory()) {
+        return false;
+    }
+    if (!F.getReturnType()->isIntegerTy(32) && !F.getReturnType()->isFloatTy()) {
+        return false;
+    }
+    if (F.arg_empty() || F.arg_size() > maxArguments) {
+        return false;
+    }
+    for (const Argument &arg: F.args()) {
+        if (!arg.getType()->isIntegerTy(32)) {
+            return false;
+        }
+    }
+
+    // 统计递归调用，只有一个不在循环中的递归调用点时，每次调用只产生一个子问题，不值得缓存
+    std::vector<CallBase *> recursiveCalls;
+    for (BasicBlock &BB: F) {
+        for (Instruction &I: BB) {
+            auto *CB = llvm::dyn_cast<CallBase>(&I);
+            if (CB && CB->getCalledFunction() == &F) {
+                recursiveCalls.emplace_back(CB);
+            }
+        }
+    }
+    if (recursiveCalls.size() >= 2) {
+        return true;
+    }
+    if (recursiveCalls.size() == 1) {
+        LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+        return LI.getLoopFor(recursiveCalls.front()->getParent()) != nullptr;
+    }
+    return false;
+}
+
+// 删除函数F、调用F的函数（直接或间接）以及这些函数的调用点上的内存属性
+static void stripMemoryAttributes(Function &F) {
+    std::set<Function *> visited{&F};
+    std::vector<Function *> worklist{&F};
+    while (!worklist.empty()) {
+        Function *callee = worklist.back();
+        worklist.pop_back();
+        for (Attribute::AttrKind kind: memoryAttributes) {
+            callee->removeFnAttr(kind);
+        }
+
+        for (User *user: callee->users()) {
+            auto *CB = llvm::dyn_cast<CallBase>(user);
+            if (!CB) {
+                continue;
+            }
+            for (Attribute::AttrKind kind: memoryAttributes) {
+                CB->removeFnAttr(kind);
+            }
+            Function *caller = CB->getFunction();
+            if (visited.insert(caller).second) {
+                worklist.emplace_back(caller);
+            }
+        }
+    }
+}
+
+static void memoize(Function &F) {
+    Module &M = *F.getParent();
+    LLVMContext &ctx = F.getContext();
+    Type *int32Ty = Type::getInt32Ty(ctx);
+    Type *int8Ty = Type::getInt8Ty(ctx);
+    unsigned argCount = F.arg_size();
+
+    // 原函数体移入f.uncached，其中的递归调用仍然调用f
+    Function *uncached = Function::Create(
+            F.getFunctionType(),
+            GlobalValue::InternalLinkage,
+            F.getName() + ".uncached",
+            M
+    );
+    uncached->copyAttributesFrom(&F);
+    uncached->getBasicBlockList().splice(uncached->begin(), F.getBasicBlockList());
+    for (unsigned i = 0; i < argCount; i++) {
+        uncached->getArg(i)->takeName(F.getArg(i));
+        F.getArg(i)->replaceAllUsesWith(uncached->getArg(i));
+    }
+
+    // 缓存表项：{参数..., 返回值, 是否有效}，零初始化即全部无效
+    std::vector<Type *> fields(argCount, int32Ty);
+    fields.emplace_back(F.getReturnType());
+    fields.emplace_back(int8Ty);
+    StructType *entryTy = StructType::get(ctx, fields);
+    ArrayType *tableTy = ArrayType::get(entryTy, tableSize);
+    auto *table = new GlobalVariable(
+            M,
+            tableTy,
+            false,
+            GlobalValue::InternalLinkage,
+            Constant::getNullValue(tableTy),
+            F.getName() + ".memo"
+    );
+
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", &F);
+    BasicBlock *hit = BasicBlock::Create(ctx, "memo.hit", &F);
+    BasicBlock *miss = BasicBlock::Create(ctx, "memo.miss", &F);
+    IRBuilder<> builder(entry);
+
+    // 哈希：h = h * 0x9e3779b1 + arg，再混合高位；单个较小的参数直接映射到连续的表项
+    Value *hash = F.getArg(0);
+    for (unsigned i = 1; i < argCount; i++) {
+        hash = builder.CreateAdd(builder.CreateMul(hash, builder.getInt32(0x9e3779b1)), F.getArg(i));
+    }
+    hash = builder.CreateXor(hash, builder.CreateLShr(hash, 16));
+    Value *index = builder.CreateAnd(hash, tableSize - 1, "memo.index");
+
+    auto field = [&](unsigned i) {
+        return builder.CreateInBoundsGEP(tableTy, table, {builder.getInt32(0), index, builder.getInt32(i)});
+    };
+
+    Value *found = builder.CreateICmpNE(builder.CreateLoad(int8Ty, field(argCount + 1)), builder.getInt8(0));
+    for (unsigned i = 0; i < argCount; i++) {
+        Value *key = builder.CreateLoad(int32Ty, field(i));
+        found = builder.CreateAnd(found, builder.CreateICmpEQ(key, F.getArg(i)));
+    }
+    builder.CreateCondBr(found, hit, miss);
+
+    builder.SetInsertPoint(hit);
+    builder.CreateRet(builder.CreateLoad(F.getReturnType(), field(argCount)));
+
+    // 未命中：计算并覆盖表项
+    builder.SetInsertPoint(miss);
+    std::vector<Value *> args;
+    for (Argument &arg: F.args()) {
+        args.emplace_back(&arg);
+    }
+    Value *result = builder.CreateCall(uncached, args);
+    for (unsigned i = 0; i < argCount; i++) {
+        builder.CreateStore(F.getArg(i), field(i));
+    }
+    builder.CreateStore(result, field(argCount));
+    builder.CreateStore(builder.getInt8(1), field(argCount + 1));
+    builder.CreateRet(result);
+
+    stripMemoryAttributes(F);
+    stripMemoryAttributes(*uncached);
+}
+
+PreservedAnalyses MemoizePass::run(Module &M, ModuleAnalysisManager &AM) {
+    FunctionAnalysisManager &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+    std::vector<Function *> candidates;
+    for (Function &F: M) {
+        if (isCandidate(F, FAM)) {
+            candidates.emplace_back(&F);
+        }
+    }
+
+    for (Function *F: candidates) {
+        log("memoize") << F->getName().str() << std::endl;
+        memoize(*F);
+    }
+
+    return candidates.empty() ? PreservedAnalyses::all() : PreservedAnalyses::none();
+}
@@ -0,0 +1,18 @@
+#ifndef SYSY_COMPILER_PASSES_MEMOIZE_H
+#define SYSY_COMPILER_PASSES_MEMOIZE_H
+
+#include <llvm/IR/PassManager.h>
+
+// 纯递归函数的自动记忆化（--memoize开启）
+// 在SysYFunctionAttrsPass之后、内联之前运行，对满足以下条件的函数：
+// 1. 内部函数，readnone（不访问内存，不做输入输出）
+// 2. 1~3个int参数，返回int或float
+// 3. 递归调用不止一次（多个递归调用点，或递归调用在循环中），只递归一次的函数（如阶乘、gcd）每个值本来就只算一次，记忆化只会变慢
+// 原函数体移入f.uncached，f改为查询直接映射的全局缓存表f.memo，未命中时调用f.uncached并写入表项；
+// f.uncached中的递归调用仍调用f，因此子问题同样被缓存
+class MemoizePass : public llvm::PassInfoMixin<MemoizePass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+#endif //SYSY_COMPILER_PASSES_MEMOIZE_H
@@ -0,0 +1,84 @@
+#include <cctype>
+#include <memory>
+#include <stdexcept>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/Support/FileSystem.h>
+#include "log.h"
+#include "parallel_codegen.h"
+
+// 汇编中符号名可能包含的字符
+static bool isSymbolChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$';
+}
+
+// 为分区中的私有标签加上分区编号，例：.LBB0_1 -> .Lp1_BB0_1
+// 各分区的函数编号都从0开始，直接拼接会产生重复的.LBB0_1、.LCPI0_0等标签
+// 伪指令均为小写，不会被误匹配
+static void renamePrivateLabels(llvm::StringRef text, unsigned partition, llvm::raw_ostream &out) {
+    std::string prefix = ".Lp" + std::to_string(partition) + "_";
+    size_t last = 0;
+    for (size_t i = 0; i + 1 < text.size(); i++) {
+        if (text[i] == '.' && text[i + 1] == 'L' && (i == 0 || !isSymbolChar(text[i - 1]))) {
+            out << text.slice(last, i) << prefix;
+            last = i + 2;
+            i++;
+        }
+    }
+    out << text.substr(last);
+}
+
+void ParallelCodeGen::emitAssembly(
+        llvm::Module &module,
+        unsigned jobs,
+        const Target::MachineFactory &factory,
+        llvm::raw_ostream &out
+) {
+    log("parallel CG") << "split module into " << jobs << " partitions" << std::endl;
+
+    std::vector<llvm::SmallString<0>> buffers(jobs);
+    std::vector<std::unique_ptr<llvm::raw_svector_ostream>> streams;
+    std::vector<llvm::raw_pwrite_stream *> streamRefs;
+    for (auto &buffer: buffers) {
+        streams.emplace_back(std::make_unique<llvm::raw_svector_ostream>(buffer));
+        streamRefs.emplace_back(streams.back().get());
+    }
+
+    llvm::splitCodeGen(module, streamRefs, {}, factory, llvm::CGFT_AssemblyFile);
+
+    // 按分区顺序拼接，保证输出是确定的
+    for (unsigned i = 0; i < jobs; i++) {
+        if (i == 0) {
+            out << buffers[i];
+        } else {
+            renamePrivateLabels(buffers[i], i, out);
+        }
+    }
+}
+
+std::vector<std::string> ParallelCodeGen::emitObjects(
+        llvm::Module &module,
+        unsigned jobs,
+        const Target::MachineFactory &factory
+) {
+    log("parallel CG") << "split module into " << jobs << " partitions" << std::endl;
+
+    std::vector<std::string> filenames;
+    std::vector<std::unique_ptr<llvm::raw_fd_ostream>> streams;
+    std::vector<llvm::raw_pwrite_stream *> streamRefs;
+    for (unsigned i = 0; i < jobs; i++) {
+        llvm::SmallString<128> filename;
+        int fd;
+        if (auto EC = llvm::sys::fs::createTemporaryFile("sysy", "o", fd, filename)) {
+            throw std::runtime_error("Could not create temporary file: " + EC.message());
+        }
+        filenames.emplace_back(filename.str());
+        streams.emplace_back(std::make_unique<llvm::raw_fd_ostream>(fd, true));
+        streamRefs.emplace_back(streams.back().get());
+    }
+
+    llvm::splitCodeGen(module, streamRefs, {}, factory, llvm::CGFT_ObjectFile);
+
+    return filenames;
+}
@@ -0,0 +1,30 @@
+#ifndef SYSY_COMPILER_PASSES_PARALLEL_CODEGEN_H
+#define SYSY_COMPILER_PASSES_PARALLEL_CODEGEN_H
+
+#include <string>
+#include <vector>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+#include "target.h"
+
+// 并行代码生成
+// 使用llvm::SplitModule将模块按函数划分为多个分区（内部链接的全局变量/函数会被外部化为hidden符号，
+// 保证跨分区引用正确），每个分区在独立的线程、独立的LLVMContext和TargetMachine中生成代码
+namespace ParallelCodeGen {
+    // 生成汇编代码，按分区顺序拼接输出，各分区的私有标签（.L前缀）会加上分区编号以避免冲突
+    void emitAssembly(
+            llvm::Module &module,
+            unsigned jobs,
+            const Target::MachineFactory &factory,
+            llvm::raw_ostream &out
+    );
+
+    // 生成多个目标文件（临时文件），按分区顺序返回文件名，由调用者负责删除
+    std::vector<std::string> emitObjects(
+            llvm::Module &module,
+            unsigned jobs,
+            const Target::MachineFactory &factory
+    );
+}
+
+#endif //SYSY_COMPILER_PASSES_PARALLEL_CODEGEN_H
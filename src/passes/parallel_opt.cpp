@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include "log.h"
+#include "parallel_opt.h"
+
+// 记录被临时外部化的符号原本的链接属性
+struct SavedLinkage {
+    llvm::GlobalValue::LinkageTypes linkage;
+    llvm::GlobalValue::VisibilityTypes visibility;
+};
+
+static llvm::SmallString<0> writeBitcode(const llvm::Module &module) {
+    llvm::SmallString<0> buffer;
+    llvm::raw_svector_ostream os(buffer);
+    llvm::WriteBitcodeToFile(module, os);
+    return buffer;
+}
+
+static std::unique_ptr<llvm::Module> parseBitcode(llvm::StringRef buffer, llvm::LLVMContext &llvmCtx) {
+    auto module = llvm::parseBitcodeFile(llvm::MemoryBufferRef(buffer, "SysY_src"), llvmCtx);
+    if (!module) {
+        throw std::logic_error(llvm::toString(module.takeError()));
+    }
+    return std::move(*module);
+}
+
+// 将内部链接的符号外部化，使其可以跨分区引用，返回原本的链接属性
+static std::map<std::string, SavedLinkage> externalize(llvm::Module &module) {
+    std::map<std::string, SavedLinkage> saved;
+    size_t anonymousCount = 0;
+    for (llvm::GlobalValue &GV: module.global_values()) {
+        if (!GV.hasLocalLinkage()) {
+            continue;
+        }
+        // 匿名符号无法通过名字在分区之间对应，为其补充名字
+        if (!GV.hasName()) {
+            GV.setName("__sysy_anon." + std::to_string(anonymousCount++));
+        }
+        saved[GV.getName().str()] = {GV.getLinkage(), GV.getVisibility()};
+        GV.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        GV.setVisibility(llvm::GlobalValue::HiddenVisibility);
+    }
+    return saved;
+}
+
+// 按指令数将函数定义划分到各分区，从大到小依次放入当前负载最小的分区
+static std::vector<std::vector<std::string>> partition(llvm::Module &module, unsigned jobs) {
+    std::vector<std::pair<std::string, size_t>> functions;
+    for (llvm::Function &F: module) {
+        if (!F.isDeclaration()) {
+            functions.emplace_back(F.getName().str(), F.getInstructionCount());
+        }
+    }
+    std::stable_sort(functions.begin(), functions.end(), [](auto &a, auto &b) {
+        return a.second > b.second;
+    });
+
+    unsigned count = std::min<size_t>(jobs, functions.size());
+    std::vector<std::vector<std::string>> partitions(count);
+    std::vector<size_t> load(count, 0);
+    for (auto &[name, size]: functions) {
+        size_t target = std::min_element(load.begin(), load.end()) - load.begin();
+        partitions[target].emplace_back(name);
+        load[target] += size;
+    }
+    return partitions;
+}
+
+// 在工作线程中优化一个分区，返回优化后的分区模块（bitcode）
+static llvm::SmallString<0> optimizePartition(
+        llvm::StringRef bitcode,
+        const std::vector<std::string> &functionNames,
+        llvm::OptimizationLevel level,
+        const Target::MachineFactory &factory,
+        const ParallelOpt::PassBuilderConfig &config
+) {
+    llvm::LLVMContext llvmCtx;
+    std::unique_ptr<llvm::Module> module = parseBitcode(bitcode, llvmCtx);
+
+    // 只保留本分区的函数定义
+    llvm::StringSet<> names;
+    for (const std::string &name: functionNames) {
+        names.insert(name);
+    }
+    for (llvm::Function &F: *module) {
+        if (!F.isDeclaration() && !names.contains(F.getName())) {
+            F.deleteBody();
+        }
+    }
+
+    // 全局变量的定义保留在原模块中，分区中仅用于常量折叠
+    for (llvm::GlobalVariable &GV: module->globals()) {
+        if (!GV.isDeclaration()) {
+            GV.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            GV.setVisibility(llvm::GlobalValue::DefaultVisibility);
+        }
+    }
+
+    auto targetMachine = factory();
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassBuilder PB(targetMachine.get());
+    config(PB);
+
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM = PB.buildModuleOptimizationPipeline(level);
+    MPM.run(*module, MAM);
+
+    return writeBitcode(*module);
+}
+
+void ParallelOpt::run(
+        llvm::Module &module,
+        unsigned jobs,
+        llvm::OptimizationLevel level,
+        const Target::MachineFactory &factory,
+        const PassBuilderConfig &config
+) {
+    std::map<std::string, SavedLinkage> saved = externalize(module);
+    std::vector<std::vector<std::string>> partitions = partition(module, jobs);
+
+    log("parallel opt") << "optimize " << partitions.size() << " partitions" << std::endl;
+
+    // 并行优化各分区
+    llvm::SmallString<0> bitcode = writeBitcode(module);
+    std::vector<llvm::SmallString<0>> results(partitions.size());
+    {
+        llvm::ThreadPool pool(llvm::hardware_concurrency(partitions.size()));
+        std::vector<std::shared_future<void>> futures;
+        for (size_t i = 0; i < partitions.size(); i++) {
+            futures.emplace_back(pool.async([&, i] {
+                results[i] = optimizePartition(bitcode, partitions[i], level, factory, config);
+            }));
+        }
+        // 传播工作线程中的异常
+        for (auto &future: futures) {
+            future.get();
+        }
+    }
+
+    // 删除原模块中的函数体，由优化后的分区提供
+    for (llvm::Function &F: module) {
+        if (!F.isDeclaration()) {
+            F.deleteBody();
+        }
+    }
+
+    // 按分区顺序链接回原模块
+    for (const auto &result: results) {
+        if (llvm::Linker::linkModules(module, parseBitcode(result, module.getContext()))) {
+            throw std::logic_error("failed to link optimized partition");
+        }
+    }
+
+    // 恢复原本的链接属性
+    for (auto &[name, linkage]: saved) {
+        llvm::GlobalValue *GV = module.getNamedValue(name);
+        if (GV && !GV->isDeclaration()) {
+            GV->setLinkage(linkage.linkage);
+            GV->setVisibility(linkage.visibility);
+        }
+    }
+}
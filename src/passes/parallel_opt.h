@@ -0,0 +1,29 @@
+#ifndef SYSY_COMPILER_PASSES_PARALLEL_OPT_H
+#define SYSY_COMPILER_PASSES_PARALLEL_OPT_H
+
+#include <functional>
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/PassBuilder.h>
+#include "target.h"
+
+// 并行函数级优化
+// 在模块级的化简（IPO、内联）完成后调用，此时剩余的函数级优化管道对各函数是相互独立的：
+// 1. 将所有内部链接的符号临时外部化，按指令数把函数定义均衡地划分到各分区
+// 2. 每个分区在独立的线程、LLVMContext、TargetMachine中，对模块副本运行优化管道
+//    副本中只保留本分区的函数定义，全局变量变为available_externally，仅用于常量折叠
+// 3. 按分区顺序将优化后的函数链接回原模块，并恢复符号原本的链接属性
+// 划分与链接顺序只取决于模块内容，因此输出是确定的
+namespace ParallelOpt {
+    // 配置PassBuilder，用于在工作线程中注册与主管道相同的扩展点回调
+    using PassBuilderConfig = std::function<void(llvm::PassBuilder &)>;
+
+    void run(
+            llvm::Module &module,
+            unsigned jobs,
+            llvm::OptimizationLevel level,
+            const Target::MachineFactory &factory,
+            const PassBuilderConfig &config
+    );
+}
+
+#endif //SYSY_COMPILER_PASSES_PARALLEL_OPT_H
@@ -1,53 +1,231 @@
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Passes/PassBuilder.h>
-#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/FileSystem.h>
-#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/FileUtilities.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/CodeGen/RegAllocRegistry.h>
+#include <llvm/Transforms/IPO/ConstantMerge.h>
+#include <llvm/Transforms/IPO/GlobalDCE.h>
+#include <llvm/Transforms/IPO/GlobalOpt.h>
+#include <llvm/Transforms/Scalar/LoopInterchange.h>
+#include <llvm/Transforms/Utils/LCSSA.h>
+#include <llvm/Transforms/Utils/LoopSimplify.h>
 #include "IR.h"
+#include "log.h"
+#include "linker.h"
+#include "target.h"
+#include "lib.h"
+#include "scope.h"
+#include "parallel_codegen.h"
+#include "parallel_opt.h"
+#include "sysy_function_attrs.h"
+#include "sysy_aa.h"
+#include "memoize.h"
+#include "recursion_to_loop.h"
+#include "range_propagation.h"
+#include "loop_parallelize.h"
+#include "loop_tiling.h"
+#include "kernel_idiom.h"
+#include "invariant_division.h"
+#include "global_localize.h"
 #include "hello_world_pass.h"
 #include "mem2reg_pass.h"
 #include "loop_deletion.h"
 #include "pass_manager.h"
 
+void PassManager::assumeInboundsSubscripts() {
+    auto &registered = llvm::cl::getRegisteredOptions();
+    auto it = registered.find("da-disable-delinearization-checks");
+    if (it != registered.end()) {
+        static_cast<llvm::cl::opt<bool> *>(it->second)->setValue(true);
+    }
+}
+
+// 注册自定义pass的扩展点回调，主管道与并行优化的工作线程共用
+static void configurePassBuilder(const Options &options, llvm::PassBuilder &PB) {
+    // 在内联之前推断SysY函数的属性（此时数组参数的alloca已被SROA消除）
+    PB.registerPipelineEarlySimplificationEPCallback(
+            [](llvm::ModulePassManager &MPM, llvm::OptimizationLevel /*level*/) {
+                MPM.addPass(SysYFunctionAttrsPass());
+            }
+    );
+
+    // 交换循环使最内层的访问连续（如按列遍历的a[j][i]），在indvars之后、循环删除与展开之前
+    // 依赖分析能否按维分析多维数组的下标见PassManager::assumeInboundsSubscripts
+    PB.registerLateLoopOptimizationsEPCallback(
+            [](llvm::LoopPassManager &LPM, llvm::OptimizationLevel /*level*/) {
+                LPM.addPass(llvm::LoopInterchangePass());
+            }
+    );
+
+    // 除数为循环不变量的除法与取模改为乘法（LICM已外提除数），之后的向量化与InstCombine可以继续处理
+    PB.registerVectorizerStartEPCallback(
+            [](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel level) {
+                if (level.getSpeedupLevel() >= 2) {
+                    FPM.addPass(llvm::LoopSimplifyPass());
+                    FPM.addPass(InvariantDivisionPass());
+                }
+            }
+    );
+
+    // 在分块之前识别矩阵乘法与卷积，整个嵌套替换为内核
+    if (options.kernels) {
+        PB.registerVectorizerStartEPCallback(
+                [](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel /*level*/) {
+                    FPM.addPass(llvm::LoopSimplifyPass());
+                    FPM.addPass(llvm::LCSSAPass());
+                    FPM.addPass(KernelIdiomPass());
+                }
+        );
+    }
+
+    // 在并行化与向量化之前分块，块循环在最外层，块内的循环仍可被并行化与向量化
+    if (options.tileSize != 0) {
+        unsigned tileSize = options.tileSize;
+        PB.registerVectorizerStartEPCallback(
+                [tileSize](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel /*level*/) {
+                    FPM.addPass(llvm::LoopSimplifyPass());
+                    FPM.addPass(llvm::LCSSAPass());
+                    FPM.addPass(LoopTilingPass(tileSize));
+                }
+        );
+    }
+
+    // 在向量化之前并行化循环，工作函数中的循环仍会被向量化；并行化要求循环为LoopSimplify与LCSSA形式
+    if (options.parallel) {
+        PB.registerVectorizerStartEPCallback(
+                [](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel /*level*/) {
+                    FPM.addPass(llvm::LoopSimplifyPass());
+                    FPM.addPass(llvm::LCSSAPass());
+                    FPM.addPass(LoopParallelizePass());
+                }
+        );
+    }
+
+#ifdef CONF_USE_DEMO_PASS
+    // 在优化管道前端加入自己的pass
+    PB.registerPipelineStartEPCallback(
+            [&](llvm::ModulePassManager &MPM, llvm::OptimizationLevel level) {
+                MPM.addPass(llvm::createModuleToFunctionPassAdaptor(HelloWorldPass()));
+                MPM.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::PromotePass()));
+                MPM.addPass(llvm::createModuleToFunctionPassAdaptor(
+                        llvm::createFunctionToLoopPassAdaptor(llvm::LoopDeletionPass())));
+            }
+    );
+#endif
+}
+
+// 并行优化：模块级的化简（IPO、内联）在当前线程完成，之后的函数级优化管道分区并行执行
+static void optimizeParallel(
+        const Options &options,
+        llvm::TargetMachine *targetMachine,
+        llvm::PassBuilder &PB,
+        llvm::ModuleAnalysisManager &MAM
+) {
+    log("PM") << "optimizing module (simplification)" << std::endl;
+    llvm::ModulePassManager simplifyMPM = PB.buildModuleSimplificationPipeline(
+            llvm::OptimizationLevel::O3,
+            llvm::ThinOrFullLTOPhase::None
+    );
+    simplifyMPM.run(IR::ctx->module, MAM);
+
+    // 模块将在pass manager之外被修改，清空已缓存的分析结果
+    MAM.clear();
+
+    std::string triple = targetMachine->getTargetTriple().str();
+    ParallelOpt::run(
+            IR::ctx->module,
+            options.jobs,
+            llvm::OptimizationLevel::O3,
+            [triple] { return Target::createTargetMachine(triple); },
+            [&options](llvm::PassBuilder &PB) { configurePassBuilder(options, PB); }
+    );
+
+    // 恢复内部链接后，清理分区之间不再被引用的符号
+    log("PM") << "optimizing module (cleanup)" << std::endl;
+    llvm::ModulePassManager cleanupMPM;
+    cleanupMPM.addPass(llvm::GlobalOptPass());
+    cleanupMPM.addPass(llvm::GlobalDCEPass());
+    cleanupMPM.addPass(llvm::ConstantMergePass());
+    cleanupMPM.run(IR::ctx->module, MAM);
+}
+
 // 使用llvm的新pass manager
 // https://llvm.org/docs/NewPassManager.html
-void PassManager::run(int optLevel, const std::string &filename) {
-
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
-
-    std::string err;
-    auto triple = "arm-unknown-linux-gnu";
-    auto target = llvm::TargetRegistry::lookupTarget(triple, err);
-    if (!target) {
-        throw std::logic_error(err);
-    }
-
-    auto CPU = "generic";
-    auto features = "";
-    llvm::TargetOptions opt;
-#ifdef CONF_HARD_FLOAT
-    opt.FloatABIType = llvm::FloatABI::Hard;
-#endif
-    auto targetMachine =
-            target->createTargetMachine(triple, CPU, features, opt, {});
+void PassManager::optimize(const Options &options, llvm::TargetMachine *targetMachine) {
+    // -emit-llvm=pre-opt / -emit-bc=pre-opt：直接输出前端生成的IR
+    if (options.emitPreOpt) {
+        return;
+    }
 
-    IR::ctx.module.setDataLayout(targetMachine->createDataLayout());
-    IR::ctx.module.setTargetTriple(triple);
+    if (options.optLevel != 0) {
+        if (options.runtimeBitcode) {
+            log("PM") << "link runtime library bitcode" << std::endl;
+            linkLibraryBitcode();
+        }
 
-    if (optLevel != 0) {
         llvm::LoopAnalysisManager LAM;
         llvm::FunctionAnalysisManager FAM;
         llvm::CGSCCAnalysisManager CGAM;
         llvm::ModuleAnalysisManager MAM;
 
         llvm::PassBuilder PB(targetMachine);
+        configurePassBuilder(options, PB);
+
+        // 在函数化简管道末尾（TailCallElim之后）将剩余的线性递归转换为循环
+        // 只在模块化简阶段运行，并行优化时也在当前线程完成
+        RecursionToLoopPass::Statistics recursionStats;
+        PB.registerScalarOptimizerLateEPCallback(
+                [&](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel /*level*/) {
+                    FPM.addPass(RecursionToLoopPass(recursionStats));
+                }
+        );
+
+        // 内联之后把只在main中使用的全局变量改为局部变量、在循环中提升标量全局变量，之后的值域传播可以看到它们的值
+        // 需要别名分析判断调用是否访问全局变量，只在当前线程运行
+        PB.registerScalarOptimizerLateEPCallback(
+                [](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel /*level*/) {
+                    FPM.addPass(llvm::LoopSimplifyPass());
+                    FPM.addPass(GlobalLocalizePass());
+                }
+        );
+
+        // 循环优化之后（循环变量的范围已知）按值域改写有符号除法、取模与比较，同样只在当前线程运行
+        RangePropagationPass::Statistics rangeStats;
+        PB.registerScalarOptimizerLateEPCallback(
+                [&](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel /*level*/) {
+                    FPM.addPass(RangePropagationPass(rangeStats));
+                }
+        );
+        auto logRangeStats = [&] {
+            log("range") << rangeStats.divisions << " sdiv and " << rangeStats.remainders
+                         << " srem made unsigned (" << rangeStats.shifts << " as shifts or masks), "
+                         << rangeStats.comparisons << " comparisons folded" << std::endl;
+        };
+
+        // 记忆化依赖SysYFunctionAttrsPass推断的readnone，回调按注册顺序执行，排在其后
+        // 只在模块化简阶段运行，并行优化时也在当前线程完成
+        if (options.memoize) {
+            PB.registerPipelineEarlySimplificationEPCallback(
+                    [](llvm::ModulePassManager &MPM, llvm::OptimizationLevel /*level*/) {
+                        MPM.addPass(MemoizePass());
+                    }
+            );
+        }
+
+        // 在默认的别名分析链之后加入SysYAA，只回答其他分析无法回答的查询
+        // 需要在registerFunctionAnalyses之前注册，否则会使用默认的AAManager
+        // 并行优化的分区中函数都被外部化，SysYAA无法推断，只在当前线程的管道中使用
+        SysYAA sysyAA;
+        FAM.registerPass([&] { return sysyAA; });
+        FAM.registerPass([&] {
+            llvm::AAManager AA = PB.buildDefaultAAPipeline();
+            AA.registerFunctionAnalysis<SysYAA>();
+            return AA;
+        });
 
         PB.registerModuleAnalyses(MAM);
         PB.registerCGSCCAnalyses(CGAM);
@@ -56,50 +234,217 @@ void PassManager::run(int optLevel, const std::string &filename) {
         PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
 
 #ifdef CONF_USE_DEMO_PASS
-        // 在优化管道前端加入自己的pass
-        PB.registerPipelineStartEPCallback(
-                [&](llvm::ModulePassManager &MPM, llvm::OptimizationLevel level) {
-                    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(HelloWorldPass()));
-                    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::PromotePass()));
-                    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(
-                            llvm::createFunctionToLoopPassAdaptor(llvm::LoopDeletionPass())));
-                }
-        );
-
         llvm::ModulePassManager MPM = PB.buildO0DefaultPipeline(
                 llvm::OptimizationLevel::O0
         );
 #else
+        if (options.jobs > 1) {
+            optimizeParallel(options, targetMachine, PB, MAM);
+            log("SysY AA") << "resolved " << sysyAA.getProvenance().resolved << " of "
+                           << sysyAA.getProvenance().queries << " queries" << std::endl;
+            log("recursion") << recursionStats.converted << " of " << recursionStats.linear.size()
+                             << " linear recursive functions converted to loops" << std::endl;
+            logRangeStats();
+            IR::show();
+            return;
+        }
+
         llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(
                 llvm::OptimizationLevel::O3
         );
 #endif
 
         log("PM") << "optimizing module" << std::endl;
-        MPM.run(IR::ctx.module, MAM);
+        MPM.run(IR::ctx->module, MAM);
+        log("SysY AA") << "resolved " << sysyAA.getProvenance().resolved << " of "
+                       << sysyAA.getProvenance().queries << " queries" << std::endl;
+        log("recursion") << recursionStats.converted << " of " << recursionStats.linear.size()
+                         << " linear recursive functions converted to loops" << std::endl;
+        logRangeStats();
 
         // 展示优化后的IR
         IR::show();
     }
+}
+
+// -emit-llvm/-emit-bc：输出LLVM IR文本或bitcode，不经过后端
+static bool isIROutput(const Options &options) {
+    return options.outputType == OutputType::LLVM_ASSEMBLY || options.outputType == OutputType::LLVM_BITCODE;
+}
+
+static void emitIR(const Options &options, llvm::raw_ostream &out) {
+    if (options.outputType == OutputType::LLVM_ASSEMBLY) {
+        log("PM") << "generate LLVM IR" << std::endl;
+        IR::ctx->module.print(out, nullptr);
+    } else {
+        log("PM") << "generate LLVM bitcode" << std::endl;
+        llvm::WriteBitcodeToFile(IR::ctx->module, out);
+    }
+}
+
+// 单线程生成汇编代码或目标文件，写入输出流
+static void emitStream(
+        llvm::TargetMachine *targetMachine,
+        llvm::raw_pwrite_stream &out,
+        llvm::CodeGenFileType fileType
+) {
+    log("PM") << (fileType == llvm::CGFT_AssemblyFile ?
+                  "generate assembly" : "generate object file") << std::endl;
+
+    // codeGenPass析构时才会将其缓冲区中的内容全部写入输出流
+    llvm::legacy::PassManager codeGenPass;
+    if (targetMachine->addPassesToEmitFile(codeGenPass, out, nullptr, fileType)) {
+        throw std::logic_error("TargetMachine can't emit a file of this type");
+    }
 
-    // 生成汇编文件
+    codeGenPass.run(IR::ctx->module);
+}
+
+// 单线程生成汇编文件或目标文件
+static void emitFile(
+        llvm::TargetMachine *targetMachine,
+        const std::string &filename,
+        llvm::CodeGenFileType fileType
+) {
     std::error_code EC;
     llvm::raw_fd_ostream file(filename, EC, llvm::sys::fs::OF_None);
     if (EC) {
         throw std::runtime_error("Could not open file: " + EC.message());
     }
+    emitStream(targetMachine, file, fileType);
+    file.close();
+}
+
+// 将模块划分为多个分区，在多个线程上并行生成代码
+static void emitParallel(const Options &options, llvm::TargetMachine *targetMachine) {
+    std::string triple = targetMachine->getTargetTriple().str();
+    auto factory = [triple] {
+        return Target::createTargetMachine(triple);
+    };
+
+    // 汇编文件按分区顺序拼接
+    if (options.outputType == OutputType::ASSEMBLY) {
+        std::error_code EC;
+        llvm::raw_fd_ostream file(options.outputFilename, EC, llvm::sys::fs::OF_None);
+        if (EC) {
+            throw std::runtime_error("Could not open file: " + EC.message());
+        }
+        ParallelCodeGen::emitAssembly(IR::ctx->module, options.jobs, factory, file);
+        return;
+    }
+
+    // 目标文件需要借助链接器合并
+    std::vector<std::string> objectFilenames =
+            ParallelCodeGen::emitObjects(IR::ctx->module, options.jobs, factory);
+    nonstd::scope_exit cleanup([&] {
+        for (const std::string &objectFilename: objectFilenames) {
+            llvm::sys::fs::remove(objectFilename);
+        }
+    });
+
+    if (options.outputType == OutputType::OBJECT) {
+        log("PM") << "merge object files" << std::endl;
+        Linker::linkRelocatable(objectFilenames, options.outputFilename, triple, options.linker);
+    } else {
+        log("PM") << "link executable" << std::endl;
+        Linker::link(objectFilenames, options.outputFilename, triple, options.linker);
+    }
+}
+
+void PassManager::emit(const Options &options, llvm::TargetMachine *targetMachine) {
+    if (isIROutput(options)) {
+        std::error_code EC;
+        llvm::raw_fd_ostream file(
+                options.outputFilename,
+                EC,
+                options.outputType == OutputType::LLVM_ASSEMBLY ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None
+        );
+        if (EC) {
+            throw std::runtime_error("Could not open file: " + EC.message());
+        }
+        emitIR(options, file);
+        return;
+    }
+
+#ifdef CONF_USE_DEMO_REG_ALLOC
+    llvm::RegisterRegAlloc::setDefault(llvm::createBasicRegisterAllocator);
+#endif
+
+    if (options.jobs > 1) {
+        emitParallel(options, targetMachine);
+        return;
+    }
+
+    // 可执行文件需要先生成临时目标文件，再交给链接器
+    std::string filename = options.outputFilename;
+    llvm::FileRemover tempFileRemover;
+    if (options.outputType == OutputType::EXECUTABLE) {
+        llvm::SmallString<128> tempFilename;
+        if (auto EC = llvm::sys::fs::createTemporaryFile("sysy", "o", tempFilename)) {
+            throw std::runtime_error("Could not create temporary file: " + EC.message());
+        }
+        tempFileRemover.setFile(tempFilename);
+        filename = tempFilename.str().str();
+    }
+
+    // 目标文件由LLVM的集成汇编器直接生成，省去了输出、解析汇编文本的开销
+    emitFile(
+            targetMachine,
+            filename,
+            options.outputType == OutputType::ASSEMBLY ?
+                llvm::CGFT_AssemblyFile :
+                llvm::CGFT_ObjectFile
+    );
+
+    // 链接运行时库，生成可执行文件
+    if (options.outputType == OutputType::EXECUTABLE) {
+        log("PM") << "link executable" << std::endl;
+        Linker::link(
+                {filename},
+                options.outputFilename,
+                targetMachine->getTargetTriple().str(),
+                options.linker
+        );
+    }
+}
 
-    log("PM") << "generate assembly" << std::endl;
+void PassManager::emit(
+        const Options &options,
+        llvm::TargetMachine *targetMachine,
+        llvm::raw_pwrite_stream &out
+) {
+    if (isIROutput(options)) {
+        emitIR(options, out);
+        return;
+    }
 
 #ifdef CONF_USE_DEMO_REG_ALLOC
     llvm::RegisterRegAlloc::setDefault(llvm::createBasicRegisterAllocator);
 #endif
 
-    llvm::legacy::PassManager codeGenPass;
-    auto fileType = llvm::CGFT_AssemblyFile;
-    if (targetMachine->addPassesToEmitFile(codeGenPass, file, nullptr, fileType)) {
-        throw std::logic_error("TargetMachine can't emit a file of this type");
+    if (options.outputType == OutputType::EXECUTABLE) {
+        throw std::runtime_error("executable output requires an external linker");
+    }
+
+    // 并行生成的汇编代码可以直接拼接；目标文件需要外部链接器合并，因此仍在当前线程生成
+    if (options.jobs > 1 && options.outputType == OutputType::ASSEMBLY) {
+        std::string triple = targetMachine->getTargetTriple().str();
+        ParallelCodeGen::emitAssembly(IR::ctx->module, options.jobs, [triple] {
+            return Target::createTargetMachine(triple);
+        }, out);
+        return;
     }
 
-    codeGenPass.run(IR::ctx.module);
+    emitStream(
+            targetMachine,
+            out,
+            options.outputType == OutputType::ASSEMBLY ?
+                llvm::CGFT_AssemblyFile :
+                llvm::CGFT_ObjectFile
+    );
+}
+
+void PassManager::run(const Options &options, llvm::TargetMachine *targetMachine) {
+    optimize(options, targetMachine);
+    emit(options, targetMachine);
 }
@@ -2,9 +2,28 @@
 #define SYSY_COMPILER_PASSES_PASS_MANAGER_H
 
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include "options.h"
 
 namespace PassManager {
-    void run(int optLevel, const std::string &filename);
+    // 按优化级别运行优化管道，输出优化前的IR（-emit-llvm=pre-opt）时不运行
+    void optimize(const Options &options, llvm::TargetMachine *targetMachine);
+
+    // 生成汇编文件/目标文件/可执行文件/LLVM IR/bitcode
+    void emit(const Options &options, llvm::TargetMachine *targetMachine);
+
+    // 将汇编代码/目标文件/LLVM IR/bitcode写入输出流，不使用任何文件（不支持可执行文件）
+    void emit(const Options &options, llvm::TargetMachine *targetMachine, llvm::raw_pwrite_stream &out);
+
+    // 优化并生成输出文件
+    void run(const Options &options, llvm::TargetMachine *targetMachine);
+
+    // --assume-inbounds：假定多维数组每一维的下标都不越界，依赖分析不再检查即按维分析（循环交换与分块依赖于此）
+    // SysY的数组各维长度在声明时确定，按C的语义a[i][j]中j越界（即使仍在整个数组内）是未定义行为，
+    // 对没有未定义行为的程序是安全的；默认时依赖分析只在能证明下标不越界时按维分析
+    // 修改的是LLVM进程全局的cl::opt，只能在启动时、开始任何编译之前调用一次，库接口不使用
+    void assumeInboundsSubscripts();
 }
 
 #endif //SYSY_COMPILER_PASSES_PASS_MANAGER_H
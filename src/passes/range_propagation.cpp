@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/Analysis/LazyValueInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/IR/ConstantRange.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Support/DivisionByConstantInfo.h>
+#include "range_propagation.h"
+
+using namespace llvm;
+
+// phi的值域扩大超过此次数后按阈值扩大，保证不动点迭代结束
+static constexpr unsigned maxPhiUpdates = 3;
+
+namespace {
+    // 乐观的稀疏值域分析：从空集出发沿def-use迭代到不动点，覆盖ScalarEvolution无法表示的递推，
+    // 如s = (s + x) % M（s非负依赖于s自身非负）；不考虑分支条件，分支条件由LazyValueInfo处理
+    class RangeAnalysis {
+    public:
+        explicit RangeAnalysis(Function &F);
+
+        // 整数V的值域，没有信息时为全集
+        ConstantRange get(Value *V) const;
+
+        // I被替换为值相同的replacement，在删除I之前调用
+        void replace(Instruction *I, Value *replacement);
+
+    private:
+        DenseMap<Value *, ConstantRange> ranges;
+        DenseMap<PHINode *, unsigned> phiUpdates;
+        // 扩大时的阈值：函数中出现的常量c及c±1（如取模后的上界c - 1），按位宽分组、有符号升序
+        std::map<unsigned, std::vector<APInt>> thresholds;
+        SmallPtrSet<BasicBlock *, 32> reachable;
+
+        ConstantRange lookup(Value *V) const;
+        ConstantRange transfer(Instruction *I) const;
+        ConstantRange widen(PHINode *phi, const ConstantRange &old, const ConstantRange &range);
+    };
+}
+
+RangeAnalysis::RangeAnalysis(Function &F) {
+    SetVector<Instruction *> worklist;
+    for (BasicBlock *BB: ReversePostOrderTraversal<Function *>(&F)) {
+        reachable.insert(BB);
+        for (Instruction &I: *BB) {
+            for (Value *operand: I.operands()) {
+                if (auto *constant = llvm::dyn_cast<ConstantInt>(operand)) {
+                    const APInt &value = constant->getValue();
+                    std::vector<APInt> &values = thresholds[value.getBitWidth()];
+                    values.emplace_back(value);
+                    if (!value.isMinSignedValue()) {
+                        values.emplace_back(value - 1);
+                    }
+                    if (!value.isMaxSignedValue()) {
+                        values.emplace_back(value + 1);
+                    }
+                }
+            }
+            if (I.getType()->isIntegerTy()) {
+                ranges.try_emplace(&I, I.getType()->getIntegerBitWidth(), false);
+                worklist.insert(&I);
+            }
+        }
+    }
+    for (auto &[width, values]: thresholds) {
+        llvm::sort(values, [](const APInt &a, const APInt &b) { return a.slt(b); });
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+    }
+
+    while (!worklist.empty()) {
+        Instruction *I = worklist.pop_back_val();
+        ConstantRange &old = ranges.find(I)->second;
+        ConstantRange range = transfer(I);
+        if (auto *phi = llvm::dyn_cast<PHINode>(I)) {
+            range = widen(phi, old, range);
+        }
+        if (range == old) {
+            continue;
+        }
+        old = range;
+        for (User *user: I->users()) {
+            auto *userInst = llvm::dyn_cast<Instruction>(user);
+            if (userInst && ranges.count(userInst)) {
+                worklist.insert(userInst);
+            }
+        }
+    }
+}
+
+ConstantRange RangeAnalysis::lookup(Value *V) const {
+    if (auto *constant = llvm::dyn_cast<ConstantInt>(V)) {
+        return ConstantRange(constant->getValue());
+    }
+    auto it = ranges.find(V);
+    if (it != ranges.end()) {
+        return it->second;
+    }
+    return ConstantRange::getFull(V->getType()->getIntegerBitWidth());
+}
+
+ConstantRange RangeAnalysis::transfer(Instruction *I) const {
+    unsigned width = I->getType()->getIntegerBitWidth();
+    if (auto *phi = llvm::dyn_cast<PHINode>(I)) {
+        ConstantRange range = ConstantRange::getEmpty(width);
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+            if (reachable.count(phi->getIncomingBlock(i))) {
+                range = range.unionWith(lookup(phi->getIncomingValue(i)), ConstantRange::Signed);
+            }
+        }
+        return range;
+    }
+    if (auto *select = llvm::dyn_cast<SelectInst>(I)) {
+        return lookup(select->getTrueValue()).unionWith(lookup(select->getFalseValue()), ConstantRange::Signed);
+    }
+    if (auto *cast = llvm::dyn_cast<CastInst>(I)) {
+        if (cast->getSrcTy()->isIntegerTy()) {
+            return lookup(cast->getOperand(0)).castOp(cast->getOpcode(), width);
+        }
+    } else if (auto *binary = llvm::dyn_cast<BinaryOperator>(I)) {
+        ConstantRange lhs = lookup(binary->getOperand(0)), rhs = lookup(binary->getOperand(1));
+        // 有nsw/nuw标记的运算溢出是未定义行为，结果不回绕
+        if (auto *overflowing = llvm::dyn_cast<OverflowingBinaryOperator>(binary)) {
+            unsigned noWrap = (overflowing->hasNoSignedWrap() ? OverflowingBinaryOperator::NoSignedWrap : 0) |
+                              (overflowing->hasNoUnsignedWrap() ? OverflowingBinaryOperator::NoUnsignedWrap : 0);
+            if (noWrap) {
+                return lhs.overflowingBinaryOp(binary->getOpcode(), rhs, noWrap);
+            }
+        }
+        return lhs.binaryOp(binary->getOpcode(), rhs);
+    } else if (auto *intrinsic = llvm::dyn_cast<IntrinsicInst>(I)) {
+        if (ConstantRange::isIntrinsicSupported(intrinsic->getIntrinsicID())) {
+            SmallVector<ConstantRange, 2> operands;
+            for (Value *operand: intrinsic->args()) {
+                if (!operand->getType()->isIntegerTy()) {
+                    return ConstantRange::getFull(width);
+                }
+                operands.emplace_back(lookup(operand));
+            }
+            return ConstantRange::intrinsic(intrinsic->getIntrinsicID(), operands);
+        }
+    }
+    return ConstantRange::getFull(width);
+}
+
+ConstantRange RangeAnalysis::widen(PHINode *phi, const ConstantRange &old, const ConstantRange &range) {
+    if (old.isEmptySet() || range == old || ++phiUpdates[phi] <= maxPhiUpdates) {
+        return range;
+    }
+    // 下界减小时取不大于它的最大阈值，上界增大时取不小于它的最小阈值，没有时取有符号数的边界
+    ConstantRange merged = old.unionWith(range, ConstantRange::Signed);
+    unsigned width = merged.getBitWidth();
+    const std::vector<APInt> &values = thresholds[width];
+    APInt lower = merged.getSignedMin(), upper = merged.getSignedMax();
+    if (lower.slt(old.getSignedMin())) {
+        auto it = std::upper_bound(values.begin(), values.end(), lower, [](const APInt &a, const APInt &b) {
+            return a.slt(b);
+        });
+        lower = it == values.begin() ? APInt::getSignedMinValue(width) : *std::prev(it);
+    }
+    if (upper.sgt(old.getSignedMax())) {
+        auto it = std::lower_bound(values.begin(), values.end(), upper, [](const APInt &a, const APInt &b) {
+            return a.slt(b);
+        });
+        upper = it == values.end() ? APInt::getSignedMaxValue(width) : *it;
+    }
+    return ConstantRange::getNonEmpty(lower, upper + 1);
+}
+
+ConstantRange RangeAnalysis::get(Value *V) const {
+    ConstantRange range = lookup(V);
+    return range.isEmptySet() ? ConstantRange::getFull(range.getBitWidth()) : range;
+}
+
+void RangeAnalysis::replace(Instruction *I, Value *replacement) {
+    auto it = ranges.find(I);
+    if (it == ranges.end()) {
+        return;
+    }
+    ConstantRange range = it->second;
+    ranges.erase(it);
+    if (llvm::isa<Instruction>(replacement)) {
+        ranges.erase(replacement);
+        ranges.try_emplace(replacement, range);
+    }
+}
+
+// V在at处的有符号值域：三种分析的结果取交集
+static ConstantRange getRange(
+        Value *V,
+        Instruction *at,
+        const RangeAnalysis &RA,
+        ScalarEvolution &SE,
+        LazyValueInfo &LVI
+) {
+    return RA.get(V)
+            .intersectWith(SE.getSignedRange(SE.getSCEV(V)), ConstantRange::Signed)
+            .intersectWith(LVI.getConstantRange(V, at, false), ConstantRange::Signed);
+}
+
+// 被除数非负、除数为正时改为无符号运算，返回新的值，否则返回nullptr
+// 除数为常量时后端用乘法代替除法：无符号的魔数需要额外的加法修正时（如7），比有符号的符号修正更长，保留有符号运算
+static Value *toUnsigned(
+        BinaryOperator *I,
+        const RangeAnalysis &RA,
+        ScalarEvolution &SE,
+        LazyValueInfo &LVI,
+        bool &shift
+) {
+    Value *lhs = I->getOperand(0), *rhs = I->getOperand(1);
+    if (!getRange(lhs, I, RA, SE, LVI).isAllNonNegative() ||
+        !getRange(rhs, I, RA, SE, LVI).getSignedMin().isStrictlyPositive()) {
+        return nullptr;
+    }
+    IRBuilder<> builder(I);
+    bool isDivision = I->getOpcode() == Instruction::SDiv;
+    auto *divisor = llvm::dyn_cast<ConstantInt>(rhs);
+    shift = divisor && divisor->getValue().isPowerOf2();
+    if (divisor && !shift && UnsignedDivisonByConstantInfo::get(divisor->getValue()).IsAdd) {
+        return nullptr;
+    }
+    if (shift) {
+        if (isDivision) {
+            return builder.CreateLShr(lhs, divisor->getValue().logBase2(), "", I->isExact());
+        }
+        return builder.CreateAnd(lhs, divisor->getValue() - 1);
+    }
+    if (isDivision) {
+        return builder.CreateUDiv(lhs, rhs, "", I->isExact());
+    }
+    return builder.CreateURem(lhs, rhs);
+}
+
+// 比较的结果在cmp处确定时返回对应的常量，否则返回nullptr
+static Constant *foldComparison(ICmpInst *cmp, const RangeAnalysis &RA, ScalarEvolution &SE, LazyValueInfo &LVI) {
+    Value *lhs = cmp->getOperand(0), *rhs = cmp->getOperand(1);
+    if (!lhs->getType()->isIntegerTy() || (llvm::isa<Constant>(lhs) && llvm::isa<Constant>(rhs))) {
+        return nullptr;
+    }
+    ICmpInst::Predicate predicate = cmp->getPredicate(), inverse = cmp->getInversePredicate();
+    const SCEV *lhsSCEV = SE.getSCEV(lhs), *rhsSCEV = SE.getSCEV(rhs);
+    ConstantRange lhsRange = getRange(lhs, cmp, RA, SE, LVI), rhsRange = getRange(rhs, cmp, RA, SE, LVI);
+    if (SE.isKnownPredicateAt(predicate, lhsSCEV, rhsSCEV, cmp) || lhsRange.icmp(predicate, rhsRange)) {
+        return ConstantInt::getTrue(cmp->getType());
+    }
+    if (SE.isKnownPredicateAt(inverse, lhsSCEV, rhsSCEV, cmp) || lhsRange.icmp(inverse, rhsRange)) {
+        return ConstantInt::getFalse(cmp->getType());
+    }
+    return nullptr;
+}
+
+PreservedAnalyses RangePropagationPass::run(Function &F, FunctionAnalysisManager &AM) {
+    ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    LazyValueInfo &LVI = AM.getResult<LazyValueAnalysis>(F);
+    RangeAnalysis RA(F);
+
+    bool changed = false;
+    for (BasicBlock &BB: F) {
+        for (Instruction &I: llvm::make_early_inc_range(BB)) {
+            Value *replacement = nullptr;
+            if (auto *binary = llvm::dyn_cast<BinaryOperator>(&I)) {
+                if ((binary->getOpcode() != Instruction::SDiv && binary->getOpcode() != Instruction::SRem) ||
+                    !binary->getType()->isIntegerTy()) {
+                    continue;
+                }
+                bool shift = false;
+                replacement = toUnsigned(binary, RA, SE, LVI, shift);
+                if (replacement) {
+                    (binary->getOpcode() == Instruction::SDiv ? stats.divisions : stats.remainders)++;
+                    stats.shifts += shift;
+                }
+            } else if (auto *cmp = llvm::dyn_cast<ICmpInst>(&I)) {
+                replacement = foldComparison(cmp, RA, SE, LVI);
+                stats.comparisons += replacement != nullptr;
+            }
+            if (!replacement) {
+                continue;
+            }
+            if (auto *inst = llvm::dyn_cast<Instruction>(replacement)) {
+                inst->takeName(&I);
+            }
+            SE.forgetValue(&I);
+            RA.replace(&I, replacement);
+            I.replaceAllUsesWith(replacement);
+            I.eraseFromParent();
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return PreservedAnalyses::all();
+    }
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
@@ -0,0 +1,31 @@
+#ifndef SYSY_COMPILER_PASSES_RANGE_PROPAGATION_H
+#define SYSY_COMPILER_PASSES_RANGE_PROPAGATION_H
+
+#include <llvm/IR/PassManager.h>
+
+// 整数值域传播：前端的除法与取模都是有符号的（sdiv/srem），arm上需要修正符号或调用__aeabi_idivmod
+// 值域由ScalarEvolution（循环变量按迭代次数的范围）与LazyValueInfo（支配的分支条件）共同给出：
+// 1. 被除数非负、除数为正时，sdiv/srem改为udiv/urem，除数为2的幂时改为移位/按位与
+// 2. 由值域可以确定结果的整数比较替换为常量，由后续的SimplifyCFG删除不可达的分支
+class RangePropagationPass : public llvm::PassInfoMixin<RangePropagationPass> {
+public:
+    // 统计信息，由调用者持有，管道结束后输出
+    struct Statistics {
+        // 改为无符号的除法与取模
+        unsigned divisions = 0;
+        unsigned remainders = 0;
+        // 其中除数为2的幂、改为移位或按位与的
+        unsigned shifts = 0;
+        // 替换为常量的比较
+        unsigned comparisons = 0;
+    };
+
+    explicit RangePropagationPass(Statistics &stats) : stats(stats) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+
+private:
+    Statistics &stats;
+};
+
+#endif //SYSY_COMPILER_PASSES_RANGE_PROPAGATION_H
@@ -0,0 +1,259 @@
+#include <vector>
+#include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/Analysis/CFG.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/PatternMatch.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/Local.h>
+#include "log.h"
+#include "recursion_to_loop.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+// 找到唯一的递归调用点，不在循环中（每次调用至多递归一次）
+static CallInst *findRecursiveCall(Function &F, LoopInfo &LI) {
+    CallInst *recursiveCall = nullptr;
+    for (BasicBlock &BB: F) {
+        for (Instruction &I: BB) {
+            auto *CB = llvm::dyn_cast<CallBase>(&I);
+            if (!CB || CB->getCalledFunction() != &F) {
+                continue;
+            }
+            auto *CI = llvm::dyn_cast<CallInst>(CB);
+            if (recursiveCall || !CI || CI->hasOperandBundles() || LI.getLoopFor(&BB)) {
+                return nullptr;
+            }
+            recursiveCall = CI;
+        }
+    }
+    return recursiveCall;
+}
+
+// 递归调用的每个参数是原参数加上的常量（不变的参数为空），无法反推时返回false
+static bool getSteps(Function &F, CallInst *CI, std::vector<ConstantInt *> &steps) {
+    bool stepping = false;
+    for (Argument &arg: F.args()) {
+        Value *actual = CI->getArgOperand(arg.getArgNo());
+        ConstantInt *step = nullptr;
+        if (actual != &arg) {
+            const APInt *C;
+            if (match(actual, m_Add(m_Specific(&arg), m_APInt(C)))) {
+                step = ConstantInt::get(F.getContext(), *C);
+            } else if (match(actual, m_Sub(m_Specific(&arg), m_APInt(C)))) {
+                step = ConstantInt::get(F.getContext(), -*C);
+            } else {
+                return false;
+            }
+            stepping = true;
+        }
+        steps.emplace_back(step);
+    }
+    // 参数不变的递归不会终止
+    return stepping;
+}
+
+// 上升阶段会重新执行调用点之前的部分，其中不能有（可能代价很高的）函数调用
+static bool hasCallsBefore(Function &F, CallInst *CI) {
+    for (BasicBlock &BB: F) {
+        if (!isPotentiallyReachable(&BB, CI->getParent())) {
+            continue;
+        }
+        for (Instruction &I: BB) {
+            if (&I == CI) {
+                break;
+            }
+            auto *CB = llvm::dyn_cast<CallBase>(&I);
+            if (CB && !llvm::isa<IntrinsicInst>(CB)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool isCandidate(Function &F) {
+    if (F.isDeclaration() || F.getReturnType()->isVoidTy() || !F.onlyReadsMemory() || F.isVarArg()) {
+        return false;
+    }
+    // 转换后函数体在循环中，alloca会在每次迭代时重新分配
+    for (Instruction &I: F.getEntryBlock()) {
+        if (llvm::isa<AllocaInst>(I)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 克隆原函数体，参数按map替换；返回克隆后的入口块
+static BasicBlock *cloneBody(
+        Function &F,
+        const std::vector<BasicBlock *> &blocks,
+        ValueToValueMapTy &map,
+        const char *suffix
+) {
+    SmallVector<BasicBlock *, 16> clones;
+    for (BasicBlock *BB: blocks) {
+        BasicBlock *clone = CloneBasicBlock(BB, map, suffix, &F);
+        map[BB] = clone;
+        clones.emplace_back(clone);
+    }
+    remapInstructionsInBlocks(clones, map);
+    return clones.front();
+}
+
+// 将克隆中的ret替换为跳转到target，返回值加入phi
+static void redirectReturns(BasicBlock *entry, BasicBlock *target, PHINode *phi) {
+    std::vector<ReturnInst *> returns;
+    for (BasicBlock *BB: depth_first(entry)) {
+        if (auto *ret = llvm::dyn_cast<ReturnInst>(BB->getTerminator())) {
+            returns.emplace_back(ret);
+        }
+    }
+    for (ReturnInst *ret: returns) {
+        phi->addIncoming(ret->getReturnValue(), ret->getParent());
+        BranchInst::Create(target, ret->getParent());
+        ret->eraseFromParent();
+    }
+}
+
+static void convert(Function &F, CallInst *CI, const std::vector<ConstantInt *> &steps) {
+    LLVMContext &ctx = F.getContext();
+    Type *int32Ty = Type::getInt32Ty(ctx);
+    Type *returnTy = F.getReturnType();
+
+    // 调用点之后的部分单独成块，下降阶段删除
+    SplitBlock(CI->getParent(), CI->getNextNode());
+    std::vector<BasicBlock *> original;
+    for (BasicBlock &BB: F) {
+        original.emplace_back(&BB);
+    }
+
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", &F, &F.front());
+    BasicBlock *downHeader = BasicBlock::Create(ctx, "down.header", &F);
+    BasicBlock *downLatch = BasicBlock::Create(ctx, "down.latch", &F);
+    BasicBlock *upPreheader = BasicBlock::Create(ctx, "up.preheader", &F);
+    BasicBlock *upHeader = BasicBlock::Create(ctx, "up.header", &F);
+    BasicBlock *upBody = BasicBlock::Create(ctx, "up.body", &F);
+    BasicBlock *upLatch = BasicBlock::Create(ctx, "up.latch", &F);
+    BasicBlock *exit = BasicBlock::Create(ctx, "exit", &F);
+    IRBuilder<> builder(entry);
+    builder.CreateBr(downHeader);
+
+    // 下降：每次迭代执行调用点之前的部分，递归时进入下一层，到达基本情况时进入上升阶段
+    builder.SetInsertPoint(downHeader);
+    PHINode *depth = builder.CreatePHI(int32Ty, 2, "depth");
+    depth->addIncoming(builder.getInt32(0), entry);
+    std::vector<PHINode *> downArgs(F.arg_size(), nullptr);
+    ValueToValueMapTy downMap;
+    for (Argument &arg: F.args()) {
+        if (steps[arg.getArgNo()]) {
+            PHINode *phi = builder.CreatePHI(arg.getType(), 2, arg.getName() + ".down");
+            phi->addIncoming(&arg, entry);
+            downArgs[arg.getArgNo()] = phi;
+            downMap[&arg] = phi;
+        }
+    }
+    builder.CreateBr(cloneBody(F, original, downMap, ".down"));
+
+    auto *downCall = llvm::cast<CallInst>(downMap[CI]);
+    BasicBlock *downCallBlock = downCall->getParent();
+    downCallBlock->getTerminator()->eraseFromParent();
+    BranchInst::Create(downLatch, downCallBlock);
+    for (Argument &arg: F.args()) {
+        if (PHINode *phi = downArgs[arg.getArgNo()]) {
+            phi->addIncoming(downCall->getArgOperand(arg.getArgNo()), downLatch);
+        }
+    }
+    downCall->replaceAllUsesWith(UndefValue::get(returnTy));
+    downCall->eraseFromParent();
+
+    builder.SetInsertPoint(downLatch);
+    depth->addIncoming(builder.CreateAdd(depth, builder.getInt32(1), "depth.next"), downLatch);
+    builder.CreateBr(downHeader);
+
+    builder.SetInsertPoint(upPreheader);
+    PHINode *base = builder.CreatePHI(returnTy, 2, "base");
+    redirectReturns(downHeader, upPreheader, base);
+    builder.CreateBr(upHeader);
+
+    // 上升：还剩level层时，反推上一层的参数，用下一层的结果代替递归调用，重新执行函数体
+    builder.SetInsertPoint(upHeader);
+    PHINode *result = builder.CreatePHI(returnTy, 2, "result");
+    result->addIncoming(base, upPreheader);
+    PHINode *level = builder.CreatePHI(int32Ty, 2, "level");
+    level->addIncoming(depth, upPreheader);
+    std::vector<PHINode *> upArgs(F.arg_size(), nullptr);
+    for (Argument &arg: F.args()) {
+        if (PHINode *downArg = downArgs[arg.getArgNo()]) {
+            PHINode *phi = builder.CreatePHI(arg.getType(), 2, arg.getName() + ".up");
+            phi->addIncoming(downArg, upPreheader);
+            upArgs[arg.getArgNo()] = phi;
+        }
+    }
+    builder.CreateCondBr(builder.CreateICmpEQ(level, builder.getInt32(0)), exit, upBody);
+
+    builder.SetInsertPoint(upBody);
+    ValueToValueMapTy upMap;
+    for (Argument &arg: F.args()) {
+        if (PHINode *phi = upArgs[arg.getArgNo()]) {
+            upMap[&arg] = builder.CreateSub(phi, steps[arg.getArgNo()], arg.getName() + ".prev");
+        }
+    }
+    builder.CreateBr(cloneBody(F, original, upMap, ".up"));
+
+    auto *upCall = llvm::cast<CallInst>(upMap[CI]);
+    upCall->replaceAllUsesWith(result);
+    upCall->eraseFromParent();
+
+    builder.SetInsertPoint(upLatch);
+    PHINode *next = builder.CreatePHI(returnTy, 2, "result.next");
+    redirectReturns(upBody, upLatch, next);
+    result->addIncoming(next, upLatch);
+    level->addIncoming(builder.CreateSub(level, builder.getInt32(1), "level.next"), upLatch);
+    for (Argument &arg: F.args()) {
+        if (PHINode *phi = upArgs[arg.getArgNo()]) {
+            phi->addIncoming(upMap[&arg], upLatch);
+        }
+    }
+    builder.CreateBr(upHeader);
+
+    builder.SetInsertPoint(exit);
+    builder.CreateRet(result);
+
+    // 删除原函数体与下降阶段中调用点之后的部分
+    for (BasicBlock *BB: original) {
+        BB->dropAllReferences();
+    }
+    for (BasicBlock *BB: original) {
+        BB->eraseFromParent();
+    }
+    removeUnreachableBlocks(F);
+}
+
+PreservedAnalyses RecursionToLoopPass::run(Function &F, FunctionAnalysisManager &AM) {
+    if (!isCandidate(F)) {
+        return PreservedAnalyses::all();
+    }
+
+    CallInst *CI = findRecursiveCall(F, AM.getResult<LoopAnalysis>(F));
+    if (!CI) {
+        return PreservedAnalyses::all();
+    }
+    stats.linear.insert(&F);
+
+    std::vector<ConstantInt *> steps;
+    if (!getSteps(F, CI, steps) || hasCallsBefore(F, CI)) {
+        log("recursion") << F.getName().str() << ": arguments not invertible or calls before recursion" << std::endl;
+        return PreservedAnalyses::all();
+    }
+
+    convert(F, CI, steps);
+    stats.converted++;
+    log("recursion") << F.getName().str() << ": converted to loops" << std::endl;
+    return PreservedAnalyses::none();
+}
@@ -0,0 +1,32 @@
+#ifndef SYSY_COMPILER_PASSES_RECURSION_TO_LOOP_H
+#define SYSY_COMPILER_PASSES_RECURSION_TO_LOOP_H
+
+#include <set>
+#include <llvm/IR/PassManager.h>
+
+// 线性递归转循环，处理TailCallElim无法消除的递归，如return n * f(n - 1) % M
+// 条件：函数只读内存、没有alloca，只有一个不在循环中的递归调用点，
+// 递归调用的每个参数为原参数本身或原参数加减常量（可以反推上一层的参数）
+// 转换为两个循环，按与递归完全相同的顺序求值，不依赖运算的结合律，取模、溢出回绕的结果与递归一致：
+// 1. 下降：执行调用点之前的部分，直到某一层不再递归（到达基本情况），记录层数
+// 2. 上升：从基本情况的返回值出发，逐层反推参数，重新执行调用点之前的部分（只读内存，结果相同），
+//    用下一层的结果代替递归调用，执行调用点之后的部分
+class RecursionToLoopPass : public llvm::PassInfoMixin<RecursionToLoopPass> {
+public:
+    // 统计信息，由调用者持有，管道结束后输出
+    struct Statistics {
+        // 只有一个不在循环中的递归调用点的函数（线性递归），同一函数可能在CGSCC管道中被多次访问
+        std::set<const llvm::Function *> linear;
+        // 其中转换为循环的函数
+        unsigned converted = 0;
+    };
+
+    explicit RecursionToLoopPass(Statistics &stats) : stats(stats) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+
+private:
+    Statistics &stats;
+};
+
+#endif //SYSY_COMPILER_PASSES_RECURSION_TO_LOOP_H
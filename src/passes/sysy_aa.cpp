@@ -0,0 +1,145 @@
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include "log.h"
+#include "sysy_aa.h"
+
+using namespace llvm;
+
+AnalysisKey SysYAA::Key;
+
+SysYAAProvenance::FunctionHandle::FunctionHandle(Function *F, SysYAAProvenance *provenance)
+        : CallbackVH(F), provenance(provenance) {}
+
+void SysYAAProvenance::FunctionHandle::deleted() {
+    // 删除map中的项会析构本对象，之后不能再访问成员
+    provenance->functions.erase(llvm::cast<Function>(getValPtr()));
+}
+
+void SysYAAProvenance::FunctionHandle::allUsesReplacedWith(Value *) {
+    deleted();
+}
+
+// 函数的所有使用都是直接调用时，参数只能指向调用点传入的对象
+static bool hasOnlyDirectCalls(const Function &F) {
+    if (!F.hasLocalLinkage() || F.isDeclaration()) {
+        return false;
+    }
+    for (const Use &use: F.uses()) {
+        const auto *CB = llvm::dyn_cast<CallBase>(use.getUser());
+        if (!CB || !CB->isCallee(&use)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SysYAAProvenance::analyze(Module &M) {
+    functions.clear();
+
+    // 乐观地从空集合出发，沿调用点传播到不动点
+    for (Function &F: M) {
+        FunctionInfo &info = functions[&F];
+        info.handle = std::make_unique<FunctionHandle>(&F, this);
+        info.candidate = hasOnlyDirectCalls(F);
+        info.arguments.resize(F.arg_size());
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &[F, info]: functions) {
+            if (!info.candidate) {
+                continue;
+            }
+            for (const User *user: F->users()) {
+                const auto *CB = llvm::cast<CallBase>(user);
+                for (const Argument &arg: F->args()) {
+                    Objects &objects = info.arguments[arg.getArgNo()];
+                    if (!arg.getType()->isPointerTy()) {
+                        continue;
+                    }
+                    if (arg.getArgNo() >= CB->arg_size()) {
+                        changed |= !objects.unknown;
+                        objects.unknown = true;
+                        continue;
+                    }
+                    changed |= collect(CB->getArgOperand(arg.getArgNo()), objects);
+                }
+            }
+        }
+    }
+
+    unsigned known = 0;
+    for (auto &[F, info]: functions) {
+        for (const Argument &arg: F->args()) {
+            known += info.candidate && arg.getType()->isPointerTy() && !info.arguments[arg.getArgNo()].unknown;
+        }
+    }
+    log("SysY AA") << known << " array arguments with known objects" << std::endl;
+}
+
+const SysYAAProvenance::Objects *SysYAAProvenance::lookup(const Argument *arg) {
+    Function *F = const_cast<Function *>(arg->getParent());
+    auto info = functions.find(F);
+    if (info == functions.end()) {
+        analyze(*F->getParent());
+        info = functions.find(F);
+    }
+
+    if (!info->second.candidate || info->second.arguments[arg->getArgNo()].unknown) {
+        return nullptr;
+    }
+    return &info->second.arguments[arg->getArgNo()];
+}
+
+bool SysYAAProvenance::collect(const Value *ptr, Objects &objects) {
+    if (objects.unknown) {
+        return false;
+    }
+
+    SmallVector<const Value *, 4> underlying;
+    getUnderlyingObjects(ptr, underlying, nullptr, 0);
+
+    size_t size = objects.values.size();
+    for (const Value *object: underlying) {
+        if (llvm::isa<GlobalVariable>(object) || llvm::isa<AllocaInst>(object)) {
+            objects.values.insert(object);
+            continue;
+        }
+
+        auto *arg = llvm::dyn_cast<Argument>(object);
+        const Objects *argObjects = arg ? lookup(arg) : nullptr;
+        if (!argObjects) {
+            objects.unknown = true;
+            objects.values.clear();
+            return true;
+        }
+        objects.values.insert(argObjects->values.begin(), argObjects->values.end());
+    }
+    return objects.values.size() != size;
+}
+
+AliasResult SysYAAResult::alias(const MemoryLocation &LocA, const MemoryLocation &LocB, AAQueryInfo &AAQI) {
+    provenance.queries++;
+
+    // 两个位置的基对象集合都已知且不相交时不别名，否则交给别名分析链中的其他分析
+    SysYAAProvenance::Objects objectsA, objectsB;
+    provenance.collect(LocA.Ptr, objectsA);
+    provenance.collect(LocB.Ptr, objectsB);
+    if (objectsA.unknown || objectsB.unknown) {
+        return AAResultBase::alias(LocA, LocB, AAQI);
+    }
+    for (const Value *object: objectsA.values) {
+        if (objectsB.values.count(object)) {
+            return AAResultBase::alias(LocA, LocB, AAQI);
+        }
+    }
+
+    provenance.resolved++;
+    return AliasResult::NoAlias;
+}
+
+SysYAAResult SysYAA::run(Function &/*F*/, FunctionAnalysisManager &/*AM*/) {
+    return SysYAAResult(*provenance);
+}
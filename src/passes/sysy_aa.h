@@ -0,0 +1,98 @@
+#ifndef SYSY_COMPILER_PASSES_SYSY_AA_H
+#define SYSY_COMPILER_PASSES_SYSY_AA_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/ValueHandle.h>
+
+// SysY数组参数的跨过程别名分析
+// 数组参数只能由调用点传入，因此沿调用图传播每个数组参数可能指向的基对象（全局变量、局部数组），
+// 两个指针的基对象集合不相交时不别名。前端把数组参数降低为裸指针后，
+// BasicAA无法区分两个数组参数，或数组参数与被调函数直接访问的全局数组
+// 基对象集合是模块级的信息，由分析对象持有，所有函数的查询共享；
+// 遇到未记录的函数（如DeadArgElim、ArgPromotion重建的函数）时重新计算
+class SysYAAProvenance {
+public:
+    // 基对象集合，unknown表示可能指向任意对象
+    struct Objects {
+        std::set<const llvm::Value *> values;
+        bool unknown = false;
+    };
+
+    // 收集指针的基对象，参数使用其已知的基对象集合，返回是否有变化
+    bool collect(const llvm::Value *ptr, Objects &objects);
+
+    // 查询数（BasicAA等无法回答、交给本分析的）与其中证明不别名的数
+    unsigned queries = 0;
+    unsigned resolved = 0;
+
+private:
+    // 函数被删除或替换时丢弃其参数的信息，避免地址被新函数复用
+    class FunctionHandle : public llvm::CallbackVH {
+    public:
+        FunctionHandle(llvm::Function *F, SysYAAProvenance *provenance);
+        void deleted() override;
+        void allUsesReplacedWith(llvm::Value *) override;
+
+    private:
+        SysYAAProvenance *provenance;
+    };
+
+    struct FunctionInfo {
+        std::unique_ptr<FunctionHandle> handle;
+        // 地址被获取的函数（main、外部函数）的参数视为未知
+        bool candidate = false;
+        std::vector<Objects> arguments;
+    };
+
+    std::map<const llvm::Function *, FunctionInfo> functions;
+
+    void analyze(llvm::Module &M);
+
+    const Objects *lookup(const llvm::Argument *arg);
+};
+
+class SysYAAResult : public llvm::AAResultBase<SysYAAResult> {
+public:
+    explicit SysYAAResult(SysYAAProvenance &provenance) : provenance(provenance) {}
+
+    llvm::AliasResult alias(
+            const llvm::MemoryLocation &LocA,
+            const llvm::MemoryLocation &LocB,
+            llvm::AAQueryInfo &AAQI
+    );
+
+    // 不依赖函数内部的状态，函数变化后仍然有效
+    bool invalidate(llvm::Function &, const llvm::PreservedAnalyses &, llvm::FunctionAnalysisManager::Invalidator &) {
+        return false;
+    }
+
+private:
+    SysYAAProvenance &provenance;
+};
+
+// 由AAManager::registerFunctionAnalysis加入别名分析链，分析对象的副本共享同一份基对象信息
+class SysYAA : public llvm::AnalysisInfoMixin<SysYAA> {
+    friend llvm::AnalysisInfoMixin<SysYAA>;
+    static llvm::AnalysisKey Key;
+
+public:
+    using Result = SysYAAResult;
+
+    SysYAA() : provenance(std::make_shared<SysYAAProvenance>()) {}
+
+    SysYAAResult run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+
+    const SysYAAProvenance &getProvenance() const {
+        return *provenance;
+    }
+
+private:
+    std::shared_ptr<SysYAAProvenance> provenance;
+};
+
+#endif //SYSY_COMPILER_PASSES_SYSY_AA_H
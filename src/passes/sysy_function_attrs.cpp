@@ -0,0 +1,427 @@
+#include <map>
+#include <set>
+#include <vector>
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+#include "log.h"
+#include "sysy_function_attrs.h"
+
+using namespace llvm;
+
+namespace {
+    // 对一块内存的访问方式
+    struct Access {
+        bool read = false;
+        bool write = false;
+
+        bool any() const {
+            return read || write;
+        }
+
+        // 合并另一种访问方式，返回是否发生变化
+        bool merge(const Access &other) {
+            bool changed = (other.read && !read) || (other.write && !write);
+            read |= other.read;
+            write |= other.write;
+            return changed;
+        }
+    };
+
+    // 函数（含其直接、间接调用的函数）访问的内存
+    struct Summary {
+        // 非常量的全局变量
+        std::map<const GlobalVariable *, Access> globals;
+        // 数组参数指向的内存，按参数下标
+        std::vector<Access> arguments;
+        // 输入输出流等程序不可见的内存
+        bool inaccessible = false;
+        // 无法确定基对象的内存（SysY前端不会生成）
+        Access unknown;
+        // 不会抛出异常
+        bool noUnwind = true;
+    };
+
+    using SummaryMap = std::map<const Function *, Summary>;
+}
+
+// 记录函数F中通过指针ptr的访问，局部数组与常量不影响函数的属性
+static bool recordAccess(const Function &F, Summary &summary, const Value *ptr, const Access &access) {
+    SmallVector<const Value *, 4> objects;
+    getUnderlyingObjects(ptr, objects, nullptr, 0);
+
+    bool changed = false;
+    for (const Value *object: objects) {
+        if (llvm::isa<AllocaInst>(object)) {
+            continue;
+        }
+        if (auto *GV = llvm::dyn_cast<GlobalVariable>(object)) {
+            if (!GV->isConstant()) {
+                changed |= summary.globals[GV].merge(access);
+            }
+        } else if (auto *arg = llvm::dyn_cast<Argument>(object); arg && arg->getParent() == &F) {
+            changed |= summary.arguments[arg->getArgNo()].merge(access);
+        } else {
+            changed |= summary.unknown.merge(access);
+        }
+    }
+    return changed;
+}
+
+// 记录调用的影响：已分析的函数使用其汇总，声明（运行时库、libc）使用调用点与函数上的属性
+static bool recordCall(const Function &F, Summary &summary, const CallBase &CB, const SummaryMap &summaries) {
+    if (CB.doesNotAccessMemory() || CB.isLifetimeStartOrEnd() ||
+        llvm::isa<DbgInfoIntrinsic>(CB) || llvm::isa<AssumeInst>(CB)) {
+        return false;
+    }
+
+    bool changed = false;
+    if (auto *MI = llvm::dyn_cast<MemIntrinsic>(&CB)) {
+        changed |= recordAccess(F, summary, MI->getRawDest(), {false, true});
+        if (auto *MTI = llvm::dyn_cast<MemTransferInst>(MI)) {
+            changed |= recordAccess(F, summary, MTI->getRawSource(), {true, false});
+        }
+        return changed;
+    }
+
+    const Function *callee = CB.getCalledFunction();
+    auto it = callee ? summaries.find(callee) : summaries.end();
+    if (it != summaries.end()) {
+        // 递归调用时汇总与当前函数是同一个对象，复制一份再合并
+        Summary calleeSummary = it->second;
+        for (const auto &[GV, access]: calleeSummary.globals) {
+            changed |= summary.globals[GV].merge(access);
+        }
+        for (unsigned i = 0; i < calleeSummary.arguments.size(); i++) {
+            if (calleeSummary.arguments[i].any()) {
+                changed |= recordAccess(F, summary, CB.getArgOperand(i), calleeSummary.arguments[i]);
+            }
+        }
+        changed |= calleeSummary.inaccessible && !summary.inaccessible;
+        summary.inaccessible |= calleeSummary.inaccessible;
+        changed |= summary.unknown.merge(calleeSummary.unknown);
+        return changed;
+    }
+
+    if (CB.onlyAccessesInaccessibleMemory() || CB.onlyAccessesInaccessibleMemOrArgMem()) {
+        changed |= !summary.inaccessible;
+        summary.inaccessible = true;
+    }
+    if (CB.onlyAccessesInaccessibleMemory()) {
+        return changed;
+    }
+    if (!CB.onlyAccessesArgMemory() && !CB.onlyAccessesInaccessibleMemOrArgMem()) {
+        return summary.unknown.merge({true, !CB.onlyReadsMemory()}) || changed;
+    }
+    for (unsigned i = 0; i < CB.arg_size(); i++) {
+        const Value *arg = CB.getArgOperand(i);
+        if (!arg->getType()->isPointerTy() || CB.doesNotAccessMemory(i)) {
+            continue;
+        }
+        Access access{!CB.onlyWritesMemory(i), !CB.onlyReadsMemory(i) && !CB.onlyReadsMemory()};
+        changed |= recordAccess(F, summary, arg, access);
+    }
+    return changed;
+}
+
+// 汇总函数F的访存，返回是否发生变化（同一调用图环中的函数需要迭代至不动点）
+static bool summarize(const Function &F, Summary &summary, const SummaryMap &summaries) {
+    bool changed = false;
+    for (const Instruction &I: instructions(F)) {
+        if (auto *load = llvm::dyn_cast<LoadInst>(&I)) {
+            changed |= recordAccess(F, summary, load->getPointerOperand(), {true, false});
+        } else if (auto *store = llvm::dyn_cast<StoreInst>(&I)) {
+            changed |= recordAccess(F, summary, store->getPointerOperand(), {false, true});
+        } else if (auto *CB = llvm::dyn_cast<CallBase>(&I)) {
+            changed |= recordCall(F, summary, *CB, summaries);
+
+            const Function *callee = CB->getCalledFunction();
+            auto it = callee ? summaries.find(callee) : summaries.end();
+            bool noUnwind = it != summaries.end() ? it->second.noUnwind : CB->doesNotThrow();
+            if (!noUnwind && summary.noUnwind) {
+                summary.noUnwind = false;
+                changed = true;
+            }
+        } else if (I.mayReadOrWriteMemory()) {
+            changed |= summary.unknown.merge({I.mayReadFromMemory(), I.mayWriteToMemory()});
+        }
+        if (I.mayThrow() && !llvm::isa<CallBase>(I) && summary.noUnwind) {
+            summary.noUnwind = false;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// 指针只用于访存、地址计算与作为调用的参数（被调函数的参数也是nocapture）时，不会被保存
+// 同一调用图环中的函数尚未推断属性，假定其参数不会被保存（环中的函数都满足上述条件时成立）
+static bool isCaptured(const Value *ptr, const std::set<const Function *> &scc, std::set<const Value *> &visited) {
+    if (!visited.insert(ptr).second) {
+        return false;
+    }
+    for (const Use &use: ptr->uses()) {
+        const auto *user = llvm::cast<Instruction>(use.getUser());
+        if (llvm::isa<LoadInst>(user)) {
+            continue;
+        }
+        if (auto *store = llvm::dyn_cast<StoreInst>(user)) {
+            if (store->getValueOperand() == ptr) {
+                return true;
+            }
+            continue;
+        }
+        if (auto *CB = llvm::dyn_cast<CallBase>(user)) {
+            if (!CB->isArgOperand(&use)) {
+                return true;
+            }
+            if (!scc.count(CB->getCalledFunction()) && !CB->doesNotCapture(CB->getArgOperandNo(&use))) {
+                return true;
+            }
+            continue;
+        }
+        if (llvm::isa<GetElementPtrInst>(user) || llvm::isa<BitCastInst>(user) ||
+            llvm::isa<PHINode>(user) || llvm::isa<SelectInst>(user)) {
+            if (isCaptured(user, scc, visited)) {
+                return true;
+            }
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+// 按汇总结果设置函数与参数的属性
+static void applySummary(Function &F, const Summary &summary, const std::set<const Function *> &scc) {
+    if (summary.noUnwind) {
+        F.addFnAttr(Attribute::NoUnwind);
+    }
+
+    bool readsGlobal = false;
+    bool writesGlobal = false;
+    for (const auto &[GV, access]: summary.globals) {
+        readsGlobal |= access.read;
+        writesGlobal |= access.write;
+    }
+    bool readsArgument = false;
+    bool writesArgument = false;
+    for (const Access &access: summary.arguments) {
+        readsArgument |= access.read;
+        writesArgument |= access.write;
+    }
+    bool reads = readsGlobal || readsArgument || summary.unknown.read;
+    bool writes = writesGlobal || writesArgument || summary.unknown.write;
+
+    for (Attribute::AttrKind kind: {
+            Attribute::ReadNone, Attribute::ReadOnly, Attribute::WriteOnly, Attribute::ArgMemOnly,
+            Attribute::InaccessibleMemOnly, Attribute::InaccessibleMemOrArgMemOnly
+    }) {
+        F.removeFnAttr(kind);
+    }
+
+    // 输入输出流既读又写（会改变流的状态）
+    if (!summary.inaccessible) {
+        if (!reads && !writes) {
+            F.addFnAttr(Attribute::ReadNone);
+        } else if (!writes) {
+            F.addFnAttr(Attribute::ReadOnly);
+        } else if (!reads) {
+            F.addFnAttr(Attribute::WriteOnly);
+        }
+    }
+    if (summary.globals.empty() && !summary.unknown.any()) {
+        bool accessesArgument = readsArgument || writesArgument;
+        if (summary.inaccessible && accessesArgument) {
+            F.addFnAttr(Attribute::InaccessibleMemOrArgMemOnly);
+        } else if (summary.inaccessible) {
+            F.addFnAttr(Attribute::InaccessibleMemOnly);
+        } else if (accessesArgument) {
+            F.addFnAttr(Attribute::ArgMemOnly);
+        }
+    }
+
+    for (Argument &arg: F.args()) {
+        if (!arg.getType()->isPointerTy()) {
+            continue;
+        }
+        std::set<const Value *> visited;
+        if (!isCaptured(&arg, scc, visited)) {
+            arg.addAttr(Attribute::NoCapture);
+        }
+
+        // 存在无法确定基对象的访问时，不能确定参数指向的内存是否被访问
+        if (summary.unknown.any()) {
+            continue;
+        }
+        for (Attribute::AttrKind kind: {Attribute::ReadNone, Attribute::ReadOnly, Attribute::WriteOnly}) {
+            arg.removeAttr(kind);
+        }
+        const Access &access = summary.arguments[arg.getArgNo()];
+        if (!access.any()) {
+            arg.addAttr(Attribute::ReadNone);
+        } else if (!access.write) {
+            arg.addAttr(Attribute::ReadOnly);
+        } else if (!access.read) {
+            arg.addAttr(Attribute::WriteOnly);
+        }
+    }
+}
+
+// 函数的所有使用都是直接调用时，才能根据调用点推断参数的属性
+static bool hasOnlyDirectCalls(const Function &F) {
+    if (!F.hasLocalLinkage()) {
+        return false;
+    }
+    for (const Use &use: F.uses()) {
+        const auto *CB = llvm::dyn_cast<CallBase>(use.getUser());
+        if (!CB || !CB->isCallee(&use)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+    // 数组参数noalias的推断：从所有候选参数出发，删除在某个调用点上不满足条件的参数，直到不动点
+    class NoAliasInference {
+    public:
+        explicit NoAliasInference(const SummaryMap &summaries) : summaries(summaries) {}
+
+        std::set<const Argument *> run(Module &M) {
+            for (Function &F: M) {
+                // 从外部不可达的函数（如未被调用的运行时库函数）没有汇总
+                auto summary = summaries.find(&F);
+                if (summary == summaries.end() || summary->second.unknown.any() || !hasOnlyDirectCalls(F)) {
+                    continue;
+                }
+                for (Argument &arg: F.args()) {
+                    if (arg.getType()->isPointerTy() && arg.hasNoCaptureAttr()) {
+                        candidates.insert(&arg);
+                    }
+                }
+            }
+
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (auto it = candidates.begin(); it != candidates.end();) {
+                    if (holdsAtAllCalls(**it)) {
+                        ++it;
+                    } else {
+                        it = candidates.erase(it);
+                        changed = true;
+                    }
+                }
+            }
+            return candidates;
+        }
+
+    private:
+        const SummaryMap &summaries;
+        std::set<const Argument *> candidates;
+
+        // 可以区分的基对象：全局数组、局部数组，以及（假设成立的）noalias参数
+        bool isIdentified(const Value *object) const {
+            if (llvm::isa<AllocaInst>(object) || llvm::isa<GlobalVariable>(object)) {
+                return true;
+            }
+            auto *arg = llvm::dyn_cast<Argument>(object);
+            return arg && candidates.count(arg);
+        }
+
+        bool holdsAtAllCalls(const Argument &arg) const {
+            const Function &F = *arg.getParent();
+            const Summary &summary = summaries.at(&F);
+            const Access &access = summary.arguments[arg.getArgNo()];
+
+            for (const Use &use: F.uses()) {
+                const auto &CB = *llvm::cast<CallBase>(use.getUser());
+                SmallVector<const Value *, 4> objects;
+                getUnderlyingObjects(CB.getArgOperand(arg.getArgNo()), objects, nullptr, 0);
+
+                for (const Value *object: objects) {
+                    if (!isIdentified(object)) {
+                        return false;
+                    }
+
+                    // 被调函数直接访问作为实参的全局数组，且其中一方有写入
+                    if (auto *GV = llvm::dyn_cast<GlobalVariable>(object)) {
+                        auto global = summary.globals.find(GV);
+                        if (global != summary.globals.end() && (access.write || global->second.write)) {
+                            return false;
+                        }
+                    }
+
+                    // 同一个基对象作为其他数组参数传入，且其中一方有写入
+                    for (unsigned i = 0; i < CB.arg_size(); i++) {
+                        if (i == arg.getArgNo() || !CB.getArgOperand(i)->getType()->isPointerTy()) {
+                            continue;
+                        }
+                        const Access &other = summary.arguments[i];
+                        if (!access.write && !other.write) {
+                            continue;
+                        }
+                        SmallVector<const Value *, 4> otherObjects;
+                        getUnderlyingObjects(CB.getArgOperand(i), otherObjects, nullptr, 0);
+                        for (const Value *otherObject: otherObjects) {
+                            if (otherObject == object || !isIdentified(otherObject)) {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+    };
+}
+
+PreservedAnalyses SysYFunctionAttrsPass::run(Module &M, ModuleAnalysisManager &/*AM*/) {
+    // 自底向上（被调函数在前）遍历调用图的强连通分量
+    SummaryMap summaries;
+    CallGraph CG(M);
+    for (auto SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
+        std::vector<Function *> functions;
+        for (CallGraphNode *node: *SCC) {
+            Function *F = node->getFunction();
+            if (F && !F->isDeclaration()) {
+                functions.emplace_back(F);
+                summaries[F].arguments.resize(F->arg_size());
+            }
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (Function *F: functions) {
+                changed |= summarize(*F, summaries[F], summaries);
+            }
+        }
+
+        std::set<const Function *> scc(functions.begin(), functions.end());
+        for (Function *F: functions) {
+            applySummary(*F, summaries[F], scc);
+        }
+        if (functions.size() == 1 && !SCC.hasCycle()) {
+            functions.front()->addFnAttr(Attribute::NoRecurse);
+        }
+    }
+
+    std::set<const Argument *> noAlias = NoAliasInference(summaries).run(M);
+    for (const Argument *arg: noAlias) {
+        const_cast<Argument *>(arg)->addAttr(Attribute::NoAlias);
+    }
+
+    for (Function &F: M) {
+        if (!F.isDeclaration()) {
+            log("SysY attrs") << F.getName().str() << ": " << F.getAttributes().getAsString(AttributeList::FunctionIndex) << std::endl;
+        }
+    }
+    log("SysY attrs") << noAlias.size() << " noalias array arguments" << std::endl;
+
+    return PreservedAnalyses::none();
+}
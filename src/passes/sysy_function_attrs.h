@@ -0,0 +1,20 @@
+#ifndef SYSY_COMPILER_PASSES_SYSY_FUNCTION_ATTRS_H
+#define SYSY_COMPILER_PASSES_SYSY_FUNCTION_ATTRS_H
+
+#include <llvm/IR/PassManager.h>
+
+// SysY函数属性推断，在模块化简管道的前端（SROA、EarlyCSE之后，内联之前）运行
+// SysY中除了数组参数没有指针，数组参数只能用于访存或继续传给其他函数，不会被保存或返回，因此：
+// 1. 所有函数nounwind，数组参数nocapture
+// 2. 按调用图自底向上汇总每个函数访问的内存（全局变量、数组参数、输入输出流），
+//    推断readnone/readonly/writeonly/argmemonly/inaccessiblememonly等属性，以及参数的readonly/writeonly/readnone
+// 3. 不在调用图的环中的函数norecurse
+// 4. 内部函数的所有调用点上，数组参数的基对象（全局数组、局部数组或noalias的参数）
+//    与其他参数、被调函数直接访问的全局数组都不冲突时，参数noalias
+// mustprogress由前端根据循环条件是否为常量添加（见FunctionDef::codeGen）
+class SysYFunctionAttrsPass : public llvm::PassInfoMixin<SysYFunctionAttrsPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+#endif //SYSY_COMPILER_PASSES_SYSY_FUNCTION_ATTRS_H
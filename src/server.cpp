@@ -0,0 +1,149 @@
+#include <csignal>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <llvm/Support/raw_ostream.h>
+#include "log.h"
+#include "lexer.h"
+#include "target.h"
+#include "server_protocol.h"
+#include "server.h"
+
+// 收到SIGINT/SIGTERM时删除套接字文件，信号处理函数中只能使用固定的缓冲区
+static char socketFile[sizeof(sockaddr_un::sun_path)];
+
+static void onTerminate(int) {
+    unlink(socketFile);
+    _exit(0);
+}
+
+static int listenOn(const std::string &socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path too long: " + socketPath);
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    // 能连接上说明已有服务器在运行，否则是上次遗留的套接字文件
+    if (int fd = ServerProtocol::connectTo(socketPath); fd >= 0) {
+        close(fd);
+        throw std::runtime_error("compile server already running on " + socketPath);
+    }
+    unlink(socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("failed to create socket: " + std::string(strerror(errno)));
+    }
+    // 套接字只允许当前用户访问，请求中的文件路径以服务器的权限打开
+    mode_t mask = umask(0077);
+    int result = bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+    umask(mask);
+    if (result < 0 || listen(fd, SOMAXCONN) < 0) {
+        std::string message = strerror(errno);
+        close(fd);
+        throw std::runtime_error("failed to listen on " + socketPath + ": " + message);
+    }
+    return fd;
+}
+
+// 在子进程中处理一个请求，结束时直接退出，不返回
+[[noreturn]] static void handleJob(int connection, const Server::CompileFunction &compile) {
+    int status = 2;
+    try {
+        ServerProtocol::Request request;
+        if (!ServerProtocol::receiveRequest(connection, request)) {
+            _exit(0);
+        }
+
+        // 使用客户端的标准输入/输出/错误与工作目录，--run模式下程序的输入输出也直接透传
+        for (int i = 0; i < 3; i++) {
+            dup2(request.fds[i], i);
+            close(request.fds[i]);
+        }
+        if (chdir(request.workingDirectory.c_str()) < 0) {
+            throw std::runtime_error("failed to change directory to " + request.workingDirectory);
+        }
+
+        std::vector<char *> argv{const_cast<char *>("sysy_compiler")};
+        for (std::string &argument: request.arguments) {
+            if (argument.rfind("--server", 0) == 0) {
+                throw std::runtime_error("--server is not allowed in a compile request");
+            }
+            argv.emplace_back(argument.data());
+        }
+        argv.emplace_back(nullptr);
+
+        status = compile(static_cast<int>(argv.size() - 1), argv.data());
+    } catch (std::exception &e) {
+        err("server") << e.what() << std::endl;
+    }
+
+    // 子进程不运行静态析构函数，退出前手动刷新所有输出
+    std::cout.flush();
+    std::cerr.flush();
+    llvm::outs().flush();
+    llvm::errs().flush();
+    fflush(nullptr);
+
+    try {
+        ServerProtocol::sendStatus(connection, status);
+    } catch (std::exception &) {
+        // 客户端已断开
+    }
+    _exit(0);
+}
+
+int Server::serve(const std::string &socketPath, const CompileFunction &compile) {
+    // 预先完成所有与请求无关的初始化，子进程直接继承
+    Target::initialize();
+    Target::warmUp();
+    Lexer::initialize();
+
+    int listenFD = listenOn(socketPath);
+    strcpy(socketFile, socketPath.c_str());
+    signal(SIGINT, onTerminate);
+    signal(SIGTERM, onTerminate);
+    // 子进程退出后由内核自动回收，服务器不需要等待
+    signal(SIGCHLD, SIG_IGN);
+
+    log("server") << "listening on " << socketPath << std::endl;
+
+    while (true) {
+        int connection = accept4(listenFD, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            err("server") << "accept failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listenFD);
+            // 编译过程中可能等待外部链接器，恢复默认的信号处理
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            handleJob(connection, compile);
+        }
+        if (pid < 0) {
+            err("server") << "fork failed: " << strerror(errno) << std::endl;
+        }
+        close(connection);
+    }
+
+    close(listenFD);
+    unlink(socketFile);
+    return 1;
+}
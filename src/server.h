@@ -0,0 +1,19 @@
+#ifndef SYSY_COMPILER_SERVER_H
+#define SYSY_COMPILER_SERVER_H
+
+#include <functional>
+#include <string>
+
+// 编译服务器（--server）：常驻进程，在UNIX域套接字上接收sysy_compiler_client转发的编译请求
+// 启动时完成LLVM目标平台的初始化、为各平台创建目标机器、编译词法规则，
+// 每个请求fork出一个子进程完成编译，子进程继承这些已初始化的状态，
+// 请求之间互不影响，某个请求崩溃也不会影响服务器
+namespace Server {
+    // 编译一个请求，参数与返回值同main函数
+    using CompileFunction = std::function<int(int argc, char *argv[])>;
+
+    // 监听socketPath，循环处理请求，只在出错时返回
+    int serve(const std::string &socketPath, const CompileFunction &compile);
+}
+
+#endif //SYSY_COMPILER_SERVER_H
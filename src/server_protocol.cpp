@@ -0,0 +1,181 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server_protocol.h"
+
+// 请求格式：4字节的正文长度（同时携带3个文件描述符），随后是以'\0'分隔的工作目录与各个参数
+
+static void writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("failed to write to compile server socket: " + std::string(strerror(errno)));
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+// 读取恰好size个字节，在读取任何数据前遇到EOF时返回false
+static bool readAll(int fd, char *data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, data + total, size - total);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("failed to read from compile server socket: " + std::string(strerror(errno)));
+        }
+        if (n == 0) {
+            if (total == 0) {
+                return false;
+            }
+            throw std::runtime_error("truncated message from compile server socket");
+        }
+        total += n;
+    }
+    return true;
+}
+
+std::string ServerProtocol::defaultSocketPath() {
+    if (const char *path = std::getenv("SYSY_SERVER_SOCKET")) {
+        return path;
+    }
+    return "/tmp/sysy_compiler-" + std::to_string(getuid()) + ".sock";
+}
+
+int ServerProtocol::connectTo(const std::string &socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // 套接字路径是可预测的，其他用户可以抢先监听；请求中会传递标准输入/输出/错误与工作目录，
+    // 只连接同一用户运行的服务器
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0 ||
+        length != sizeof(credentials) || credentials.uid != getuid()) {
+        close(fd);
+        errno = EPERM;
+        return -1;
+    }
+    return fd;
+}
+
+void ServerProtocol::sendRequest(int socket, const Request &request) {
+    std::string body = request.workingDirectory;
+    body += '\0';
+    for (const std::string &argument: request.arguments) {
+        body += argument;
+        body += '\0';
+    }
+
+    uint32_t size = body.size();
+    iovec iov{&size, sizeof(size)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(request.fds))]{};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(request.fds));
+    memcpy(CMSG_DATA(cmsg), request.fds, sizeof(request.fds));
+
+    ssize_t n;
+    do {
+        n = sendmsg(socket, &message, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != sizeof(size)) {
+        throw std::runtime_error("failed to send request to compile server: " + std::string(strerror(errno)));
+    }
+    writeAll(socket, body.data(), body.size());
+}
+
+bool ServerProtocol::receiveRequest(int socket, Request &request) {
+    uint32_t size = 0;
+    iovec iov{&size, sizeof(size)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(request.fds))]{};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n == 0) {
+        return false;
+    }
+    if (n != sizeof(size)) {
+        throw std::runtime_error("malformed request header");
+    }
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(request.fds))) {
+        throw std::runtime_error("request does not carry standard streams");
+    }
+    memcpy(request.fds, CMSG_DATA(cmsg), sizeof(request.fds));
+
+    std::string body(size, '\0');
+    if (size > 0 && !readAll(socket, body.data(), size)) {
+        throw std::runtime_error("truncated request");
+    }
+    if (body.empty() || body.back() != '\0') {
+        throw std::runtime_error("malformed request body");
+    }
+
+    request.arguments.clear();
+    size_t begin = body.find('\0');
+    request.workingDirectory = body.substr(0, begin);
+    for (begin++; begin < body.size();) {
+        size_t end = body.find('\0', begin);
+        request.arguments.emplace_back(body.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return true;
+}
+
+void ServerProtocol::sendStatus(int socket, int status) {
+    int32_t value = status;
+    writeAll(socket, reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+bool ServerProtocol::receiveStatus(int socket, int &status) {
+    int32_t value;
+    if (!readAll(socket, reinterpret_cast<char *>(&value), sizeof(value))) {
+        return false;
+    }
+    status = value;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef SYSY_COMPILER_SERVER_PROTOCOL_H
+#define SYSY_COMPILER_SERVER_PROTOCOL_H
+
+#include <string>
+#include <vector>
+
+// 编译服务器与客户端之间的通信协议（UNIX域套接字）
+// 客户端发送一个请求：工作目录、命令行参数，并通过SCM_RIGHTS传递自身的标准输入/输出/错误
+// 服务器编译结束后回复一个退出码，编译过程中的诊断信息直接写入客户端传来的标准错误
+// 本文件不依赖LLVM，客户端只需链接server_protocol.cpp
+namespace ServerProtocol {
+    // 一次编译请求
+    struct Request {
+        std::string workingDirectory;
+        std::vector<std::string> arguments;
+        // 标准输入、标准输出、标准错误
+        int fds[3] = {-1, -1, -1};
+    };
+
+    // 套接字路径：环境变量SYSY_SERVER_SOCKET，默认为/tmp/sysy_compiler-<uid>.sock
+    std::string defaultSocketPath();
+
+    // 连接到服务器，失败或服务器进程不属于当前用户（SO_PEERCRED）时返回-1
+    int connectTo(const std::string &socketPath);
+
+    void sendRequest(int socket, const Request &request);
+
+    // 对方在发送请求前关闭连接时返回false
+    bool receiveRequest(int socket, Request &request);
+
+    void sendStatus(int socket, int status);
+
+    // 对方在发送退出码前关闭连接（如编译进程崩溃）时返回false
+    bool receiveStatus(int socket, int &status);
+}
+
+#endif //SYSY_COMPILER_SERVER_PROTOCOL_H
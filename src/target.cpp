@@ -0,0 +1,143 @@
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <llvm/IR/Module.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include "log.h"
+#include "target.h"
+
+void Target::initialize() {
+    static std::once_flag onceFlag;
+    std::call_once(onceFlag, [] {
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmParsers();
+        llvm::InitializeAllAsmPrinters();
+    });
+}
+
+std::string Target::normalize(const std::string &name) {
+    std::string triple = name;
+    if (triple.empty()) {
+        triple = defaultTriple;
+    } else if (triple == "native") {
+        triple = llvm::sys::getProcessTriple();
+    }
+
+    llvm::Triple parsed(llvm::Triple::normalize(triple));
+    switch (parsed.getArch()) {
+        case llvm::Triple::arm:
+        case llvm::Triple::aarch64:
+        case llvm::Triple::x86_64:
+        case llvm::Triple::riscv64:
+            break;
+        default:
+            throw std::runtime_error("unsupported target: " + name);
+    }
+
+    // 未指明操作系统时默认为linux
+    if (parsed.getOS() == llvm::Triple::UnknownOS) {
+        parsed.setOS(llvm::Triple::Linux);
+    }
+    return parsed.str();
+}
+
+// warmUp预先创建的目标机器，以triple为键，每个只会被取用一次
+static std::mutex warmMachinesMutex;
+static std::map<std::string, std::unique_ptr<llvm::TargetMachine>> warmMachines;
+
+std::unique_ptr<llvm::TargetMachine> Target::createTargetMachine(const std::string &triple) {
+    {
+        std::lock_guard<std::mutex> lock(warmMachinesMutex);
+        auto warm = warmMachines.find(triple);
+        if (warm != warmMachines.end()) {
+            auto targetMachine = std::move(warm->second);
+            warmMachines.erase(warm);
+            return targetMachine;
+        }
+    }
+
+    initialize();
+
+    std::string err;
+    auto target = llvm::TargetRegistry::lookupTarget(triple, err);
+    if (!target) {
+        throw std::logic_error(err);
+    }
+
+    llvm::Triple parsed(triple);
+    std::string CPU = "generic";
+    std::string features;
+    llvm::TargetOptions opt;
+    // 64位平台的发行版默认链接为PIE，因此生成位置无关代码；arm保持静态重定位
+    llvm::Optional<llvm::Reloc::Model> relocModel;
+
+    switch (parsed.getArch()) {
+        case llvm::Triple::arm:
+#ifdef CONF_HARD_FLOAT
+            opt.FloatABIType = llvm::FloatABI::Hard;
+#endif
+            break;
+        case llvm::Triple::aarch64:
+            relocModel = llvm::Reloc::PIC_;
+            break;
+        case llvm::Triple::x86_64:
+            CPU = "x86-64";
+            relocModel = llvm::Reloc::PIC_;
+            break;
+        case llvm::Triple::riscv64:
+            // 与linux发行版一致的RV64GC + lp64d
+            CPU = "generic-rv64";
+            features = "+m,+a,+f,+d,+c";
+            opt.MCOptions.ABIName = "lp64d";
+            relocModel = llvm::Reloc::PIC_;
+            break;
+        default:
+            break;
+    }
+
+    log("target") << "create target machine for " << triple << std::endl;
+
+    return std::unique_ptr<llvm::TargetMachine>(
+            target->createTargetMachine(triple, CPU, features, opt, relocModel)
+    );
+}
+
+void Target::warmUp() {
+    for (const char *name: {"", "aarch64", "x86_64", "riscv64", "native"}) {
+        std::string triple = normalize(name);
+        auto targetMachine = createTargetMachine(triple);
+        std::lock_guard<std::mutex> lock(warmMachinesMutex);
+        warmMachines[triple] = std::move(targetMachine);
+    }
+}
+
+void Target::configureModule(llvm::Module &module, llvm::TargetMachine &targetMachine) {
+    module.setDataLayout(targetMachine.createDataLayout());
+    module.setTargetTriple(targetMachine.getTargetTriple().str());
+
+    // riscv的浮点ABI需要同时记录在模块中，否则会与目标机器的设置冲突
+    const std::string &abiName = targetMachine.Options.MCOptions.ABIName;
+    if (!abiName.empty()) {
+        module.addModuleFlag(
+                llvm::Module::Error,
+                "target-abi",
+                llvm::MDString::get(module.getContext(), abiName)
+        );
+    }
+}
+
+bool Target::extendsInt32(const llvm::Triple &triple) {
+    return triple.getArch() == llvm::Triple::riscv64;
+}
+
+bool Target::isCharUnsigned(const llvm::Triple &triple) {
+    if (triple.isOSDarwin() || triple.isOSWindows()) {
+        return false;
+    }
+    return triple.isARM() || triple.isThumb() || triple.isAArch64() || triple.isRISCV() ||
+           triple.isPPC() || triple.getArch() == llvm::Triple::systemz;
+}
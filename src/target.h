@@ -0,0 +1,41 @@
+#ifndef SYSY_COMPILER_TARGET_H
+#define SYSY_COMPILER_TARGET_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace Target {
+    // 默认目标平台：32位arm
+    constexpr const char *defaultTriple = "arm-unknown-linux-gnu";
+
+    // 初始化LLVM中的所有目标平台，多次调用只会初始化一次
+    void initialize();
+
+    // 将--target=的参数规范化为triple，并检查是否为支持的平台
+    // 支持：arm、aarch64、x86_64、riscv64，以及表示宿主机的native
+    std::string normalize(const std::string &name);
+
+    // 创建目标机器，若有warmUp预先创建的同一平台的目标机器则直接取用
+    std::unique_ptr<llvm::TargetMachine> createTargetMachine(const std::string &triple);
+
+    // 预先为所有支持的平台各创建一个目标机器（编译服务器启动时调用）
+    // fork出的编译进程首次请求该平台时直接取用，跳过目标查找与创建
+    void warmUp();
+
+    // 用于在工作线程中创建独立的目标机器（TargetMachine不是线程安全的）
+    using MachineFactory = std::function<std::unique_ptr<llvm::TargetMachine>()>;
+
+    // 根据目标机器设置模块的triple、data layout以及ABI相关的模块标志
+    void configureModule(llvm::Module &module, llvm::TargetMachine &targetMachine);
+
+    // 调用约定是否要求32位整数参数/返回值在64位寄存器中做符号扩展（如riscv64）
+    bool extendsInt32(const llvm::Triple &triple);
+
+    // C的char在该平台上是否为无符号（arm、aarch64、riscv的Linux ABI），决定运行时库getch的扩展方式
+    bool isCharUnsigned(const llvm::Triple &triple);
+}
+
+#endif //SYSY_COMPILER_TARGET_H
@@ -0,0 +1,21 @@
+@f = internal global float 1.500000e+00
+
+declare i32 @getint()
+declare void @putint(i32)
+declare void @putch(i32)
+
+define i32 @main() {
+entry:
+  %n = call i32 @getint()
+  %fi = bitcast float* @f to i32*
+  %bits = load i32, i32* %fi
+  call void @putint(i32 %bits)
+  call void @putch(i32 10)
+  %v = load float, float* @f
+  %w = fadd float %v, 1.000000e+00
+  store float %w, float* @f
+  %bits2 = load i32, i32* %fi
+  call void @putint(i32 %bits2)
+  call void @putch(i32 10)
+  ret i32 0
+}
@@ -0,0 +1,33 @@
+declare i32 @getint()
+declare void @putint(i32)
+declare void @putch(i32)
+
+define i32 @main() {
+entry:
+  %m = call i32 @getint()
+  %n = call i32 @getint()
+  %c = icmp sgt i32 %n, 0
+  br i1 %c, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %su = phi i32 [ 0, %entry ], [ %su.next, %loop ]
+  %ss = phi i32 [ 0, %entry ], [ %ss.next, %loop ]
+  %u = urem i32 %i, %m
+  %su.next = add i32 %su, %u
+  %x = sub i32 %i, 1000
+  %r = srem i32 %x, %m
+  %ss.next = add i32 %ss, %r
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %a = phi i32 [ 0, %entry ], [ %su.next, %loop ]
+  %b = phi i32 [ 0, %entry ], [ %ss.next, %loop ]
+  call void @putint(i32 %a)
+  call void @putch(i32 32)
+  call void @putint(i32 %b)
+  call void @putch(i32 10)
+  ret i32 0
+}
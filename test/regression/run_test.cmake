@@ -0,0 +1,13 @@
+# 运行一个回归测试：compiler --run SOURCE LEVEL FLAGS < INPUT，标准输出应与EXPECTED相同
+# cmake -DCOMPILER=... -DSOURCE=... -DINPUT=... -DEXPECTED=... -DLEVEL=-O2 [-DFLAGS=--kernels] -P run_test.cmake
+separate_arguments(flags UNIX_COMMAND "${FLAGS}")
+execute_process(
+        COMMAND ${COMPILER} --run ${SOURCE} ${LEVEL} ${flags}
+        INPUT_FILE ${INPUT}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result
+)
+file(READ ${EXPECTED} expected)
+if (NOT output STREQUAL expected)
+    message(FATAL_ERROR "output mismatch (exit code ${result})\nexpected:\n${expected}\nactual:\n${output}")
+endif ()